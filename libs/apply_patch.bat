@@ -1,3 +1,4 @@
 @echo off
 git apply --directory pocketsphinx definition_fix.patch
-git apply --directory pocketsphinx gstplugin_fix.patch
\ No newline at end of file
+git apply --directory pocketsphinx gstplugin_fix.patch
+git apply --ignore-whitespace --directory pocketsphinx mgau_pool.patch
\ No newline at end of file
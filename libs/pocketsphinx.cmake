@@ -1,3 +1,10 @@
+# the patches add sources, so they are applied before the globs
+set (apply_cmd "apply_patch.bat")
+execute_process(COMMAND ${apply_cmd}
+  WORKING_DIRECTORY ${PROJECT_SOURCE_DIR}
+  RESULT_VARIABLE git_result
+  OUTPUT_VARIABLE git_ver)
+
 file(GLOB_RECURSE pocketsphinx_headers
     pocketsphinx/include/*.h
 	pocketsphinx/src/libpocketsphinx/*.h
@@ -11,12 +18,6 @@ include_directories(SYSTEM
 	pocketsphinx/include
 )
 
-set (apply_cmd "apply_patch.bat")
-execute_process(COMMAND ${apply_cmd}
-  WORKING_DIRECTORY ${PROJECT_SOURCE_DIR}
-  RESULT_VARIABLE git_result
-  OUTPUT_VARIABLE git_ver)
-
 add_library(pocketsphinx SHARED
 	${pocketsphinx_headers}
 	${pocketsphinx_src}
@@ -0,0 +1,52 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    IGraphemeToPhoneme.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Grapheme-to-phoneme converter interface declaration
+ ************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "IRecognizer.hpp"
+
+namespace api
+{
+   namespace asr
+   {
+      class IGraphemeToPhoneme;  ///< Forward declaration of grapheme-to-phoneme converter interface
+      typedef boost::shared_ptr<IGraphemeToPhoneme> GraphemeToPhonemePtr;
+
+      /**
+       * Produces pronunciations for names which are not in the dictionary,
+       * for example Jenkins job names. The result is ready for IRecognizer::phonetize().
+       */
+      class IGraphemeToPhoneme
+      {
+      public:
+         virtual ~IGraphemeToPhoneme( void ) = 0;
+
+         /**
+          * Gets the language of the phone set
+          */
+         virtual std::string getLanguage( void ) const = 0;
+
+         /**
+          * Converts the name to the dictionary word and its pronunciation.
+          * The word is the name with every character but letters, digits, '_' and apostrophes
+          * replaced with '_', so it is a single grammar token and the recognition result can be mapped back to the name.
+          * @return pair with empty pronunciation if the name has nothing to pronounce
+          */
+         virtual GraphemePhoneme convert( const std::string& name ) = 0;
+
+         /**
+          * Converts the list of names, names without pronunciation are skipped.
+          */
+         virtual GraphemePhonemeList convertAll( const std::vector<std::string>& names ) = 0;
+      };
+   }
+}
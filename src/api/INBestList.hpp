@@ -0,0 +1,62 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    INBestList.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Recognition alternatives interface declaration
+ ************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <boost/shared_ptr.hpp>
+
+namespace api
+{
+   namespace asr
+   {
+      class INBestList;    ///< Forward declaration of recognition alternatives interface
+      typedef boost::shared_ptr<const INBestList> NBestListPtr;
+
+      /**
+       * Word of the recognition alternative
+       */
+      struct RecognitionWord
+      {
+         const char* text;
+         double startTime;    ///< Seconds from the utterance start
+         double endTime;      ///< Seconds from the utterance start
+      };
+
+      /**
+       * One of the hypotheses of the utterance
+       */
+      struct RecognitionAlternative
+      {
+         const char* text;
+         long score;                      ///< Log-domain path score, the higher the better
+         const RecognitionWord* words;
+         size_t wordCount;
+      };
+
+      /**
+       * N best hypotheses of the utterance, the best one first.
+       * Strings and arrays belong to the list and are valid while it exists.
+       */
+      class INBestList
+      {
+      public:
+         virtual ~INBestList( void ) = 0;
+
+         /**
+          * Gets the number of alternatives
+          */
+         virtual size_t getSize( void ) const = 0;
+
+         /**
+          * Gets the alternative by index, 0 is the best one
+          */
+         virtual const RecognitionAlternative& getAlternative( size_t index ) const = 0;
+      };
+   }
+}
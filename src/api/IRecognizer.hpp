@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "Signals.hpp"
+#include "INBestList.hpp"
 
 /**
  * Syntax - Message
@@ -26,6 +27,24 @@ namespace api
       typedef std::pair<std::string, std::string> GraphemePhoneme;   ///< Word and it's pronunciation
       typedef std::vector<GraphemePhoneme> GraphemePhonemeList;      ///< List of words and their pronunciations
 
+      /**
+       * Wake phrase or command shortcut of the keyword search
+       */
+      struct KeyPhrase
+      {
+         std::string phrase;   ///< Words from the dictionary, for example "jenkins status"
+         double threshold;     ///< Detection threshold, for example 1e-20, the lower the more sensitive; 0 keeps the default
+
+         explicit KeyPhrase( const std::string& _phrase, double _threshold = 0.0 )
+            : phrase( _phrase )
+            , threshold( _threshold )
+         {
+
+         }
+      };
+
+      typedef std::vector<KeyPhrase> KeyPhraseList;
+
       namespace RecognizerMode
       {
          enum eRecognizerMode
@@ -63,14 +82,148 @@ namespace api
       {
          bool status;      ///< Status of the operation
          std::string text; ///< Recognized text
+         long confidence;  ///< Log-domain posterior probability of the text
+         NBestListPtr alternatives; ///< Empty unless N-best is requested by IRecognizer::setNBestSize()
+         std::string language;      ///< Language of the text, one of IRecognizer::getParallelLanguages()
+         RecognizerMode::eRecognizerMode mode;   ///< Search which recognized the text, KEY_WORD_SEARCH for a key phrase said in the command mode, alone or with other words
 
          RecognitionResultData( const std::string& _text, bool _status )
+            : status( _status )
+            , text( _text )
+            , confidence( 0 )
+            , mode( RecognizerMode::NONE )
+         {
+
+         }
+
+         RecognitionResultData( const std::string& _text, bool _status, long _confidence, const NBestListPtr& _alternatives,
+            const std::string& _language )
+            : status( _status )
+            , text( _text )
+            , confidence( _confidence )
+            , alternatives( _alternatives )
+            , language( _language )
+            , mode( RecognizerMode::NONE )
+         {
+
+         }
+
+      };
+
+      /**
+       * This structure is passed to the PartialResult signal handler.
+       * It carries the current hypothesis of the utterance which is not finished yet,
+       * the text may still change until RecognitionResult is emitted.
+       * @sa PartialResultSignal_t
+       */
+      struct PartialResultData
+      {
+         std::string text; ///< Hypothesis so far
+
+         explicit PartialResultData( const std::string& _text )
             : text( _text )
-            , status( _status )
+         {
+
+         }
+      };
+
+      namespace UtteranceMetric
+      {
+         enum eUtteranceMetric
+         {
+            AUDIO_DURATION,      ///< Seconds of the decoded audio
+            CPU_TIME,            ///< Seconds of CPU the decoder thread spent on decoding
+            REAL_TIME_FACTOR,    ///< CPU time divided by the audio duration
+            RESULT_LATENCY,      ///< Seconds from the end of speech to the RecognitionResult signal
+            FRAMES               ///< Number of frames searched
+         };
+      }
+
+      /**
+       * Measurements of one recognized utterance
+       */
+      struct UtteranceMetrics
+      {
+         RecognizerMode::eRecognizerMode mode;  ///< Search which decoded the utterance
+         double audioDuration;
+         double cpuTime;
+         double realTimeFactor;
+         double resultLatency;   ///< Counted from the moment the audio ending the speech reached the decoder
+         long frames;
+
+         UtteranceMetrics( void )
+            : mode( RecognizerMode::NONE )
+            , audioDuration( 0.0 )
+            , cpuTime( 0.0 )
+            , realTimeFactor( 0.0 )
+            , resultLatency( 0.0 )
+            , frames( 0 )
          {
 
          }
 
+         double get( UtteranceMetric::eUtteranceMetric metric ) const
+         {
+            switch ( metric )
+            {
+            case UtteranceMetric::AUDIO_DURATION:
+               return audioDuration;
+            case UtteranceMetric::CPU_TIME:
+               return cpuTime;
+            case UtteranceMetric::REAL_TIME_FACTOR:
+               return realTimeFactor;
+            case UtteranceMetric::RESULT_LATENCY:
+               return resultLatency;
+            default:
+               return static_cast<double>( frames );
+            }
+         }
+      };
+
+      /**
+       * Distribution of the metric over the recent utterances
+       */
+      struct MetricsHistogram
+      {
+         std::vector<double> upperBounds;   ///< Bucket i holds values up to upperBounds[ i ], the last bound is infinity
+         std::vector<unsigned int> counts;  ///< Number of values per bucket
+         unsigned int samples;              ///< Number of utterances
+         double mean;
+         double median;
+         double p90;
+         double max;
+
+         MetricsHistogram( void )
+            : samples( 0 )
+            , mean( 0.0 )
+            , median( 0.0 )
+            , p90( 0.0 )
+            , max( 0.0 )
+         {
+
+         }
+      };
+
+      /**
+       * Startup time breakdown of a language, in seconds
+       */
+      struct LanguageLoadTiming
+      {
+         double decoderInit;    ///< Creating the decoders, they read the model and the dictionary
+         double keyPhrases;     ///< Setting up the key phrase search
+         double grammar;        ///< Loading the compiled grammar or compiling it
+         double total;
+         size_t modelBytes;     ///< Size of the acoustic model files
+
+         LanguageLoadTiming( void )
+            : decoderInit( 0.0 )
+            , keyPhrases( 0.0 )
+            , grammar( 0.0 )
+            , total( 0.0 )
+            , modelBytes( 0 )
+         {
+
+         }
       };
 
       /**
@@ -80,6 +233,7 @@ namespace api
 
       typedef signals::signal<void ( StartListeningData e )> StartListeningSignal_t;        ///< StartListening signal type
       typedef signals::signal<void ( RecognitionResultData e )> RecognitionResultSignal_t;  ///< RecognitionResult signal type
+      typedef signals::signal<void ( PartialResultData e )> PartialResultSignal_t;          ///< PartialResult signal type
       typedef signals::signal<void ( StopListeningData e )> StopListeningSignal_t;          ///< StopListening signal type
 
       /**
@@ -100,13 +254,42 @@ namespace api
           */
          virtual void setLanguage( const std::string& language ) = 0;
 
+         /**
+          * Starts loading the language in the background,
+          * so the following setLanguage() call does not wait for it.
+          */
+         virtual void preloadLanguage( const std::string& language ) = 0;
+
+         /**
+          * Gets the installed language packs
+          */
+         virtual std::vector<std::string> getAvailableLanguages( void ) const = 0;
+
+         /**
+          * Recognizes several languages at once. The audio is captured once and decoded
+          * by a decoder per language, every utterance is reported once, in the language that fits it best.
+          * getLanguage() returns the first language, phonetize() applies to it.
+          * setLanguage() returns to a single language.
+          * @param languages - languages to recognize, all available ones if the list is empty
+          * @return false if there are no languages to recognize
+          */
+         virtual bool setParallelLanguages( const std::vector<std::string>& languages ) = 0;
+
+         /**
+          * Gets the languages which are recognized, just getLanguage() unless setParallelLanguages() is used
+          */
+         virtual std::vector<std::string> getParallelLanguages( void ) const = 0;
+
          /**
           * Gets current recognition mode
           */
          virtual api::asr::RecognizerMode::eRecognizerMode getMode( void ) const = 0;
 
          /**
-          * Sets current recognition mode
+          * Sets current recognition mode.
+          * While listening the audio capture keeps running, the new search
+          * becomes active at the next utterance boundary.
+          * NONE can be set only when not listening.
           */
          virtual bool setMode( api::asr::RecognizerMode::eRecognizerMode mode ) = 0;
 
@@ -114,6 +297,7 @@ namespace api
           * Start listening to the audio stream from the microphone.
           * Emits StartListening signal.
           * Recognizer emits RecognitionResult signal if it recognized some speech.
+          * If the recognizer is already listening, it just emits StartListening for the current mode.
           * @sa api::asr::StartListeningSignal_t
           * @sa api::asr::RecognitionResultSignal_t
           * @sa onStartListening()
@@ -141,6 +325,54 @@ namespace api
           */
          virtual bool phonetize( const std::string& group, const GraphemePhonemeList& g2pList ) = 0;
 
+         /**
+          * The same as phonetize() for names like Jenkins job names, the pronunciations come from
+          * the grapheme-to-phoneme converter of the current language.
+          * The recognized word is the name with the non-word characters replaced with '_'.
+          * @return false if the language has no converter or phonetize() fails
+          */
+         virtual bool phonetizeNames( const std::string& group, const std::vector<std::string>& names ) = 0;
+
+         /**
+          * Replaces the key phrases of the current language, works only when not listening.
+          * The detected phrase is reported as the recognition result text.
+          * Each phrase is spotted on its own, so the search cost grows with the number of phrases.
+          * The threshold of a phrase trades misses for false alarms.
+          * @param phrases - phrases with their own thresholds, the language pack ones if the list is empty
+          */
+         virtual bool setKeyPhrases( const KeyPhraseList& phrases ) = 0;
+
+         /**
+          * Sets the decoder profile of the search, from the cheapest to the most accurate one:
+          * "idle-kws", "command" (default) or "accurate". The profile sets the pruning beams
+          * and the number of HMMs evaluated per audio frame.
+          * While listening the search is rebuilt at the next utterance boundary.
+          * @return false if the profile is unknown or the mode is NONE
+          */
+         virtual bool setDecoderProfile( RecognizerMode::eRecognizerMode mode, const std::string& profile ) = 0;
+
+         /**
+          * Gets the decoder profile the search uses, it is cheaper than the set one while the governor steps it down.
+          */
+         virtual std::string getDecoderProfile( RecognizerMode::eRecognizerMode mode ) const = 0;
+
+         /**
+          * Enables the profile governor. When the average real time factor of the recent utterances
+          * of a search exceeds the limit, the search steps down to a cheaper profile, so the decoding
+          * does not fall behind the microphone. It steps back up when the load drops well below the limit.
+          * @param maxRealTimeFactor - CPU time per second of audio a search may spend, 0 (default) disables the governor
+          */
+         virtual void setProfileGovernor( double maxRealTimeFactor ) = 0;
+
+         /**
+          * Sets how long the audio has to stay silent after the speech before the utterance is finished.
+          * RecognitionResult is emitted as soon as the silence is that long, without waiting for the decoder
+          * to detect the end of speech itself. The grammar search uses 400 ms by default.
+          * @param milliseconds - trailing silence, 0 leaves the endpointing to the decoder
+          * @return false if the mode is NONE
+          */
+         virtual bool setEndpointHangover( RecognizerMode::eRecognizerMode mode, unsigned int milliseconds ) = 0;
+
          /**
           * Register handler for StartListening signal.
           * @sa api::asr::StartListeningSignal_t
@@ -155,6 +387,43 @@ namespace api
           */
          virtual signals::connection onRecognitionResult( const RecognitionResultSignal_t::slot_type& slot ) = 0;
 
+         /**
+          * Register handler for PartialResult signal.
+          * The signal is emitted only when the hypothesis text changes.
+          * @sa api::asr::PartialResultSignal_t
+          * @sa api::asr::PartialResultData
+          * @sa setPartialResultInterval()
+          */
+         virtual signals::connection onPartialResult( const PartialResultSignal_t::slot_type& slot ) = 0;
+
+         /**
+          * Limits the PartialResult signal rate.
+          * @param milliseconds - minimal interval between two PartialResult signals, 0 - no limit
+          */
+         virtual void setPartialResultInterval( unsigned int milliseconds ) = 0;
+
+         /**
+          * Sets how many alternatives RecognitionResult carries.
+          * 0 (default) disables them, the lattice is not generated then.
+          */
+         virtual void setNBestSize( size_t count ) = 0;
+
+         /**
+          * Gets the distribution of the metric over the recent utterances decoded by the search.
+          */
+         virtual MetricsHistogram getMetricsHistogram( UtteranceMetric::eUtteranceMetric metric,
+            RecognizerMode::eRecognizerMode mode ) const = 0;
+
+         /**
+          * Writes the summary of the recent utterance metrics to the log.
+          */
+         virtual void dumpMetrics( void ) const = 0;
+
+         /**
+          * Gets the startup time breakdown of the current language (or parallel languages).
+          */
+         virtual LanguageLoadTiming getLoadTiming( void ) const = 0;
+
          /**
           * Register handler for StopListening signal.
           * @sa api::asr::StopListeningSignal_t
@@ -0,0 +1,16 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    IGraphemeToPhoneme.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Grapheme-to-phoneme converter interface
+ ************************************************************************/
+#include "api/IGraphemeToPhoneme.hpp"
+
+using namespace api::asr;
+
+IGraphemeToPhoneme::~IGraphemeToPhoneme( void )
+{
+
+}
@@ -0,0 +1,16 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    INBestList.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Recognition alternatives interface
+ ************************************************************************/
+#include "api/INBestList.hpp"
+
+using namespace api::asr;
+
+INBestList::~INBestList( void )
+{
+
+}
@@ -0,0 +1,58 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CRussianG2P.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Rule-based grapheme-to-phoneme converter for the ru-RU phone set
+ ************************************************************************/
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include <api/IGraphemeToPhoneme.hpp>
+
+class CPronunciationCache;
+
+/**
+ * Converts names like "jenkins-vr", "myProject2" or "GROOT" to the ru-RU phone set.
+ * The name is split on camelCase, separators and digits, Latin parts are transliterated
+ * the way a Russian speaker reads them, short abbreviations are spelled letter by letter
+ * and numbers are read as Russian numerals.
+ * Results are memoized in the on-disk cache, so only new names are converted after a restart.
+ */
+class CRussianG2P: public api::asr::IGraphemeToPhoneme, boost::noncopyable
+{
+   explicit CRussianG2P( const std::string& cacheFile );
+
+public:
+   /**
+    * Factory method
+    * @param cacheFile - pronunciation cache file, empty string disables the persistence
+    */
+   static api::asr::GraphemeToPhonemePtr create( const std::string& cacheFile = getDefaultCacheFile() );
+
+   static std::string getDefaultCacheFile( void );
+
+public:
+   virtual ~CRussianG2P( void );
+
+   /**
+    * @sa api::asr::IGraphemeToPhoneme::getLanguage()
+    */
+   virtual std::string getLanguage( void ) const;
+
+   /**
+    * @sa api::asr::IGraphemeToPhoneme::convert()
+    */
+   virtual api::asr::GraphemePhoneme convert( const std::string& name );
+
+   /**
+    * @sa api::asr::IGraphemeToPhoneme::convertAll()
+    */
+   virtual api::asr::GraphemePhonemeList convertAll( const std::vector<std::string>& names );
+
+private:
+   typedef boost::shared_ptr<CPronunciationCache> PronunciationCachePtr;
+   PronunciationCachePtr mCache;
+};
@@ -0,0 +1,97 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CPronunciationCache.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Persistent memo cache of generated pronunciations
+ ************************************************************************/
+#include <boost/filesystem.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include "CPronunciationCache.hpp"
+#include "imp/logger/CLogger.hpp"
+
+static const char* HEADER_PREFIX = "# jenkins-vr pronunciation cache ";
+static const char FIELD_SEPARATOR = '\t';
+
+CPronunciationCache::CPronunciationCache( const std::string& fileName, const std::string& version )
+   : mFileName( fileName )
+   , mHeader( HEADER_PREFIX + version )
+{
+   if ( !mFileName.empty() )
+   {
+      load();
+   }
+}
+
+bool CPronunciationCache::lookup( const std::string& name, std::string& phones ) const
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   PronunciationMap::const_iterator it = mEntries.find( name );
+   if ( it == mEntries.end() )
+   {
+      return false;
+   }
+   phones = it->second;
+   return true;
+}
+
+void CPronunciationCache::store( const std::string& name, const std::string& phones )
+{
+   // the file format is line and tab based
+   if ( name.find_first_of( "\t\r\n" ) != std::string::npos )
+   {
+      return;
+   }
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   if ( mEntries.insert( std::make_pair( name, phones ) ).second && mFile.is_open() )
+   {
+      mFile << name << FIELD_SEPARATOR << phones << std::endl;
+   }
+}
+
+size_t CPronunciationCache::size( void ) const
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   return mEntries.size();
+}
+
+void CPronunciationCache::load( void )
+{
+   bool isValid = false;
+   {
+      std::ifstream stream( mFileName.c_str() );
+      std::string line;
+      isValid = std::getline( stream, line ) && line == mHeader;
+      while ( isValid && std::getline( stream, line ) )
+      {
+         size_t separator = line.find( FIELD_SEPARATOR );
+         if ( separator != std::string::npos )
+         {
+            mEntries[ line.substr( 0, separator ) ] = line.substr( separator + 1 );
+         }
+      }
+   }
+
+   boost::system::error_code error;
+   boost::filesystem::path parentDir = boost::filesystem::path( mFileName ).parent_path();
+   if ( !parentDir.empty() )
+   {
+      boost::filesystem::create_directories( parentDir, error );
+   }
+   if ( isValid )
+   {
+      mFile.open( mFileName.c_str(), std::ios::app );
+   }
+   else
+   {
+      mFile.open( mFileName.c_str(), std::ios::trunc );
+      mFile << mHeader << std::endl;
+   }
+   if ( !mFile.is_open() )
+   {
+      CLogger::warning() << "Can't write the pronunciation cache " << mFileName;
+   }
+   CLogger::debug() << "Pronunciation cache " << mFileName << ": " << mEntries.size() << " entries";
+}
@@ -0,0 +1,46 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CPronunciationCache.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Persistent memo cache of generated pronunciations
+ ************************************************************************/
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+
+/**
+ * Maps names to pronunciations and keeps them in a text file, one "name<TAB>phones" per line.
+ * New entries are appended to the file immediately, so a restart computes only unseen names.
+ * The file starts with a version line, the whole file is discarded when the version
+ * does not match (the rules have changed).
+ */
+class CPronunciationCache
+{
+public:
+   /**
+    * @param fileName - the cache file, created if absent; empty name keeps the cache in memory only
+    * @param version - version of the rules which produced the pronunciations
+    */
+   CPronunciationCache( const std::string& fileName, const std::string& version );
+
+   bool lookup( const std::string& name, std::string& phones ) const;
+   void store( const std::string& name, const std::string& phones );
+   size_t size( void ) const;
+
+private:
+   void load( void );
+
+private:
+   typedef boost::unordered_map<std::string, std::string> PronunciationMap;
+
+   std::string mFileName;
+   std::string mHeader;
+   PronunciationMap mEntries;
+   std::ofstream mFile;
+   mutable boost::mutex mGuard;
+};
@@ -0,0 +1,579 @@
+﻿/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CRussianG2P.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Rule-based grapheme-to-phoneme converter for the ru-RU phone set
+ ************************************************************************/
+#include <map>
+#include <cctype>
+#include <boost/assign.hpp>
+
+#include "imp/g2p/CRussianG2P.hpp"
+#include "imp/g2p/private/CPronunciationCache.hpp"
+#include "imp/logger/CLogger.hpp"
+
+using namespace api::asr;
+
+typedef std::u32string ustring;
+typedef std::vector<ustring> UStringList;
+
+static const char* LANGUAGE = "ru-RU";
+static const char* DEFAULT_CACHE_FILE = "cache/ru-RU/g2p.txt";
+
+/**
+ * Bump it when the rules change, the cache is discarded then.
+ */
+static const char* RULES_VERSION = "ru-RU/1";
+
+static const char32_t STRESS_MARK = U'+';
+static const char* PHONE_SEPARATOR = " ";
+
+/**
+ * Latin letter combinations and their Russian reading, longer ones first.
+ */
+static const std::vector<std::pair<ustring, ustring> > LATIN_DIGRAPHS = boost::assign::list_of<std::pair<ustring, ustring> >
+   ( U"sch", U"ш" )( U"tch", U"ч" )
+   ( U"sh", U"ш" )( U"ch", U"ч" )( U"zh", U"ж" )( U"kh", U"х" )( U"ph", U"ф" )( U"th", U"т" )
+   ( U"ck", U"к" )( U"qu", U"кв" )( U"tz", U"ц" )( U"oo", U"у" )( U"ee", U"и" )( U"ea", U"и" )
+   ( U"ou", U"ау" )( U"ow", U"оу" )( U"ui", U"и" )( U"ya", U"я" )( U"yu", U"ю" )( U"yo", U"ё" )( U"ye", U"е" );
+
+static const std::map<char32_t, ustring> LATIN_LETTERS = boost::assign::map_list_of<char32_t, ustring>
+   ( U'a', U"а" )( U'b', U"б" )( U'd', U"д" )( U'f', U"ф" )( U'g', U"г" )( U'h', U"х" )( U'i', U"и" )
+   ( U'j', U"дж" )( U'k', U"к" )( U'l', U"л" )( U'm', U"м" )( U'n', U"н" )( U'o', U"о" )( U'p', U"п" )
+   ( U'q', U"к" )( U'r', U"р" )( U's', U"с" )( U't', U"т" )( U'u', U"у" )( U'v', U"в" )( U'w', U"в" )
+   ( U'x', U"кс" )( U'z', U"з" );
+
+/**
+ * Russian names of Latin letters for abbreviations, '+' follows the stressed vowel.
+ */
+static const std::map<char32_t, ustring> LATIN_LETTER_NAMES = boost::assign::map_list_of<char32_t, ustring>
+   ( U'a', U"э+й" )( U'b', U"би+" )( U'c', U"си+" )( U'd', U"ди+" )( U'e', U"и+" )( U'f', U"э+ф" )
+   ( U'g', U"джи+" )( U'h', U"э+йч" )( U'i', U"а+й" )( U'j', U"дже+й" )( U'k', U"ке+й" )( U'l', U"э+л" )
+   ( U'm', U"э+м" )( U'n', U"э+н" )( U'o', U"о+у" )( U'p', U"пи+" )( U'q', U"кью+" )( U'r', U"а+р" )
+   ( U's', U"э+с" )( U't', U"ти+" )( U'u', U"ю+" )( U'v', U"ви+" )( U'w', U"да+бл ю+" )( U'x', U"э+кс" )
+   ( U'y', U"уа+й" )( U'z', U"зе+д" );
+
+static const char32_t* const NUMBER_UNITS[] = { U"но+ль", U"оди+н", U"два+", U"три+", U"четы+ре",
+   U"пя+ть", U"ше+сть", U"се+мь", U"во+семь", U"де+вять" };
+static const char32_t* const NUMBER_TEENS[] = { U"де+сять", U"оди+ннадцать", U"двена+дцать", U"трина+дцать",
+   U"четы+рнадцать", U"пятна+дцать", U"шестна+дцать", U"семна+дцать", U"восемна+дцать", U"девятна+дцать" };
+static const char32_t* const NUMBER_TENS[] = { U"", U"", U"два+дцать", U"три+дцать", U"со+рок",
+   U"пятьдеся+т", U"шестьдеся+т", U"се+мьдесят", U"во+семьдесят", U"девяно+сто" };
+static const char32_t* const NUMBER_HUNDREDS[] = { U"", U"сто+", U"две+сти", U"три+ста", U"четы+реста",
+   U"пятьсо+т", U"шестьсо+т", U"семьсо+т", U"восемьсо+т", U"девятьсо+т" };
+
+/**
+ * Consonant phones, the soft variant is the doubled phone ("t" - "tt").
+ */
+static const std::map<char32_t, std::string> CONSONANT_PHONES = boost::assign::map_list_of<char32_t, std::string>
+   ( U'б', "b" )( U'в', "v" )( U'г', "g" )( U'д', "d" )( U'ж', "zh" )( U'з', "z" )( U'й', "j" )
+   ( U'к', "k" )( U'л', "l" )( U'м', "m" )( U'н', "n" )( U'п', "p" )( U'р', "r" )( U'с', "s" )
+   ( U'т', "t" )( U'ф', "f" )( U'х', "h" )( U'ц', "c" )( U'ч', "ch" )( U'ш', "sh" )( U'щ', "sch" );
+
+static const std::map<std::string, std::string> DEVOICED_PHONES = boost::assign::map_list_of<std::string, std::string>
+   ( "b", "p" )( "bb", "pp" )( "v", "f" )( "vv", "ff" )( "g", "k" )( "gg", "kk" )
+   ( "d", "t" )( "dd", "tt" )( "z", "s" )( "zz", "ss" )( "zh", "sh" );
+
+static const ustring RUSSIAN_VOWELS = U"аеёиоуыэюя";
+static const ustring SOFTENING_LETTERS = U"еёиюяь";
+static const ustring ALWAYS_HARD = U"жшц";
+static const ustring ALWAYS_SOFT = U"чщй";
+static const ustring VOICELESS = U"пфктсшщхцч";
+static const ustring LATIN_VOWELS = U"aeiouy";
+
+static bool contains( const ustring& set, char32_t c )
+{
+   return ( c != 0 ) && ( set.find( c ) != ustring::npos );
+}
+
+static bool isLatin( char32_t c )
+{
+   return ( c >= U'a' && c <= U'z' ) || ( c >= U'A' && c <= U'Z' );
+}
+
+static bool isCyrillic( char32_t c )
+{
+   return ( c >= 0x0410 && c <= 0x044F ) || c == 0x0401 || c == 0x0451;
+}
+
+static bool isDigit( char32_t c )
+{
+   return c >= U'0' && c <= U'9';
+}
+
+static bool isUpper( char32_t c )
+{
+   return ( c >= U'A' && c <= U'Z' ) || ( c >= 0x0410 && c <= 0x042F ) || c == 0x0401;
+}
+
+static char32_t toLower( char32_t c )
+{
+   if ( ( c >= U'A' && c <= U'Z' ) || ( c >= 0x0410 && c <= 0x042F ) )
+   {
+      return c + 0x20;
+   }
+   return ( c == 0x0401 ) ? 0x0451 : c;
+}
+
+static ustring toLower( const ustring& text )
+{
+   ustring result( text );
+   for ( size_t i = 0; i < result.size(); ++i )
+   {
+      result[ i ] = toLower( result[ i ] );
+   }
+   return result;
+}
+
+/**
+ * Invalid sequences are skipped, names come from the outside.
+ */
+static ustring decodeUtf8( const std::string& text )
+{
+   ustring result;
+   size_t i = 0;
+   while ( i < text.size() )
+   {
+      unsigned char lead = static_cast<unsigned char>( text[ i ] );
+      size_t length = ( lead < 0x80 ) ? 1 : ( lead >> 5 ) == 0x6 ? 2 : ( lead >> 4 ) == 0xE ? 3 : ( lead >> 3 ) == 0x1E ? 4 : 0;
+      if ( length == 0 || i + length > text.size() )
+      {
+         ++i;
+         continue;
+      }
+      char32_t c = ( length == 1 ) ? lead : ( lead & ( 0x7F >> length ) );
+      for ( size_t j = 1; j < length; ++j )
+      {
+         c = ( c << 6 ) | ( static_cast<unsigned char>( text[ i + j ] ) & 0x3F );
+      }
+      result.push_back( c );
+      i += length;
+   }
+   return result;
+}
+
+/**
+ * Split "myProject-2", "XMLParser" or "jenkins_vr" to words.
+ */
+static UStringList splitName( const ustring& name )
+{
+   UStringList result;
+   ustring current;
+   for ( size_t i = 0; i < name.size(); ++i )
+   {
+      char32_t c = name[ i ];
+      if ( !isLatin( c ) && !isCyrillic( c ) && !isDigit( c ) )
+      {
+         if ( !current.empty() )
+         {
+            result.push_back( current );
+            current.clear();
+         }
+         continue;
+      }
+      if ( !current.empty() )
+      {
+         char32_t prev = current[ current.size() - 1 ];
+         char32_t next = ( i + 1 < name.size() ) ? name[ i + 1 ] : 0;
+         bool boundary = ( isDigit( prev ) != isDigit( c ) )
+            || ( isLatin( prev ) != isLatin( c ) && !isDigit( c ) && !isDigit( prev ) )
+            || ( !isUpper( prev ) && !isDigit( prev ) && isUpper( c ) )
+            || ( isUpper( prev ) && isUpper( c ) && next != 0 && !isUpper( next ) && !isDigit( next ) && isLatin( next ) == isLatin( c ) );
+         if ( boundary )
+         {
+            result.push_back( current );
+            current.clear();
+         }
+      }
+      current.push_back( c );
+   }
+   if ( !current.empty() )
+   {
+      result.push_back( current );
+   }
+   return result;
+}
+
+static void appendWords( UStringList& words, const ustring& text )
+{
+   size_t start = 0;
+   while ( start < text.size() )
+   {
+      size_t end = text.find( U' ', start );
+      end = ( end == ustring::npos ) ? text.size() : end;
+      if ( end > start )
+      {
+         words.push_back( text.substr( start, end - start ) );
+      }
+      start = end + 1;
+   }
+}
+
+/**
+ * Numbers up to 999 are read as numerals, longer ones and ones with leading zeros digit by digit.
+ */
+static UStringList readNumber( const ustring& digits )
+{
+   UStringList result;
+   if ( digits.size() > 3 || ( digits.size() > 1 && digits[ 0 ] == U'0' ) )
+   {
+      for ( size_t i = 0; i < digits.size(); ++i )
+      {
+         result.push_back( NUMBER_UNITS[ digits[ i ] - U'0' ] );
+      }
+      return result;
+   }
+   int value = 0;
+   for ( size_t i = 0; i < digits.size(); ++i )
+   {
+      value = value * 10 + ( digits[ i ] - U'0' );
+   }
+   if ( value == 0 )
+   {
+      result.push_back( NUMBER_UNITS[ 0 ] );
+   }
+   if ( value >= 100 )
+   {
+      result.push_back( NUMBER_HUNDREDS[ value / 100 ] );
+      value %= 100;
+   }
+   if ( value >= 20 )
+   {
+      result.push_back( NUMBER_TENS[ value / 10 ] );
+      value %= 10;
+   }
+   if ( value >= 10 )
+   {
+      result.push_back( NUMBER_TEENS[ value - 10 ] );
+   }
+   else if ( value > 0 )
+   {
+      result.push_back( NUMBER_UNITS[ value ] );
+   }
+   return result;
+}
+
+static UStringList spellLatin( const ustring& word )
+{
+   UStringList result;
+   for ( size_t i = 0; i < word.size(); ++i )
+   {
+      std::map<char32_t, ustring>::const_iterator it = LATIN_LETTER_NAMES.find( toLower( word[ i ] ) );
+      if ( it != LATIN_LETTER_NAMES.end() )
+      {
+         appendWords( result, it->second );
+      }
+   }
+   return result;
+}
+
+/**
+ * Read the Latin word the way a Russian speaker does, "jenkins" becomes "дженкинс".
+ */
+static ustring transliterate( const ustring& word )
+{
+   ustring result;
+   size_t vowelCount = 0;
+   size_t i = 0;
+   while ( i < word.size() )
+   {
+      char32_t c = word[ i ];
+      char32_t prev = ( i > 0 ) ? word[ i - 1 ] : 0;
+      char32_t next = ( i + 1 < word.size() ) ? word[ i + 1 ] : 0;
+      bool matched = false;
+      for ( size_t j = 0; j < LATIN_DIGRAPHS.size() && !matched; ++j )
+      {
+         const ustring& latin = LATIN_DIGRAPHS[ j ].first;
+         if ( word.compare( i, latin.size(), latin ) == 0 )
+         {
+            result += LATIN_DIGRAPHS[ j ].second;
+            vowelCount += contains( LATIN_VOWELS, latin[ latin.size() - 1 ] ) ? 1 : 0;
+            i += latin.size();
+            matched = true;
+         }
+      }
+      if ( matched )
+      {
+         continue;
+      }
+
+      if ( c == U'c' )
+      {
+         result += ( next == U'e' || next == U'i' || next == U'y' ) ? U"с" : U"к";
+      }
+      else if ( c == U'y' )
+      {
+         result += ( contains( LATIN_VOWELS, prev ) || contains( LATIN_VOWELS, next ) ) ? U"й" : U"и";
+         vowelCount += contains( LATIN_VOWELS, prev ) || contains( LATIN_VOWELS, next ) ? 0 : 1;
+      }
+      else if ( c == U'e' )
+      {
+         // silent final "e" as in "node" or "core"
+         if ( next == 0 && vowelCount > 0 && !contains( LATIN_VOWELS, prev ) )
+         {
+            break;
+         }
+         result += ( prev == 0 || contains( LATIN_VOWELS, prev ) ) ? U"э" : U"е";
+         ++vowelCount;
+      }
+      else
+      {
+         std::map<char32_t, ustring>::const_iterator it = LATIN_LETTERS.find( c );
+         if ( it != LATIN_LETTERS.end() )
+         {
+            result += it->second;
+            vowelCount += contains( LATIN_VOWELS, c ) ? 1 : 0;
+         }
+      }
+      ++i;
+   }
+   return result;
+}
+
+static std::string devoice( const std::string& phone )
+{
+   std::map<std::string, std::string>::const_iterator it = DEVOICED_PHONES.find( phone );
+   return ( it != DEVOICED_PHONES.end() ) ? it->second : phone;
+}
+
+static std::string vowelPhone( char32_t vowel, char32_t prev, bool stressed, bool pretonic )
+{
+   bool afterHard = contains( ALWAYS_HARD, prev );
+   switch ( vowel )
+   {
+   case U'а':
+   case U'о':
+      // akanye: unstressed "о" sounds like "а", reduced further away from the stress
+      return stressed ? ( vowel == U'а' ? "aa" : "oo" ) : ( pretonic ? "a" : "ay" );
+   case U'у':
+   case U'ю':
+      return stressed ? "uu" : "u";
+   case U'ы':
+      return stressed ? "yy" : "y";
+   case U'э':
+      return stressed ? "ee" : "y";
+   case U'е':
+      return stressed ? "ee" : ( afterHard ? "y" : "i" );
+   case U'ё':
+      return "oo";
+   case U'и':
+      return afterHard ? ( stressed ? "yy" : "y" ) : ( stressed ? "ii" : "i" );
+   case U'я':
+      return stressed ? "aa" : "i";
+   default:
+      return std::string();
+   }
+}
+
+/**
+ * Convert the Russian word to phones.
+ * '+' after a vowel marks the stress, without it the first vowel is stressed.
+ */
+static std::vector<std::string> wordToPhones( const ustring& word )
+{
+   ustring letters;
+   size_t stress = ustring::npos;
+   for ( size_t i = 0; i < word.size(); ++i )
+   {
+      if ( word[ i ] == STRESS_MARK )
+      {
+         stress = letters.empty() ? stress : letters.size() - 1;
+      }
+      else if ( isCyrillic( word[ i ] ) )
+      {
+         letters.push_back( toLower( word[ i ] ) );
+      }
+   }
+   size_t pretonic = ustring::npos;
+   for ( size_t i = 0; i < letters.size(); ++i )
+   {
+      if ( contains( RUSSIAN_VOWELS, letters[ i ] ) )
+      {
+         if ( stress == ustring::npos )
+         {
+            stress = i;
+         }
+         if ( i < stress )
+         {
+            pretonic = i;
+         }
+      }
+   }
+
+   std::vector<std::string> phones;
+   for ( size_t i = 0; i < letters.size(); ++i )
+   {
+      char32_t c = letters[ i ];
+      char32_t prev = ( i > 0 ) ? letters[ i - 1 ] : 0;
+      char32_t next = ( i + 1 < letters.size() ) ? letters[ i + 1 ] : 0;
+      std::string phone;
+      if ( contains( RUSSIAN_VOWELS, c ) )
+      {
+         // "е", "ё", "ю", "я" start with "j" at the word start and after vowels or signs
+         bool iotated = ( prev == 0 || contains( RUSSIAN_VOWELS, prev ) || prev == U'ь' || prev == U'ъ' );
+         if ( iotated && contains( U"еёюя", c ) )
+         {
+            phones.push_back( "j" );
+            phone = ( c == U'е' && i != stress ) ? "je" : vowelPhone( c, prev, i == stress, i == pretonic );
+         }
+         else
+         {
+            phone = vowelPhone( c, prev, i == stress, i == pretonic );
+         }
+      }
+      else
+      {
+         std::map<char32_t, std::string>::const_iterator it = CONSONANT_PHONES.find( c );
+         if ( it == CONSONANT_PHONES.end() )
+         {
+            continue;
+         }
+         phone = it->second;
+         if ( !contains( ALWAYS_HARD, c ) && !contains( ALWAYS_SOFT, c ) && contains( SOFTENING_LETTERS, next ) )
+         {
+            phone += phone;
+         }
+         // final devoicing and assimilation before a voiceless consonant
+         char32_t following = ( next == U'ь' ) ? ( ( i + 2 < letters.size() ) ? letters[ i + 2 ] : 0 ) : next;
+         if ( following == 0 || contains( VOICELESS, following ) )
+         {
+            phone = devoice( phone );
+         }
+      }
+      // double letters are pronounced as one sound
+      if ( !phone.empty() && ( phones.empty() || phones.back() != phone || contains( RUSSIAN_VOWELS, c ) ) )
+      {
+         phones.push_back( phone );
+      }
+   }
+   return phones;
+}
+
+/**
+ * Abbreviations like "CI", "QA" or "vcs" are spelled.
+ */
+static bool isAbbreviation( const ustring& token )
+{
+   bool allUpper = true;
+   bool hasVowel = false;
+   for ( size_t i = 0; i < token.size(); ++i )
+   {
+      allUpper = allUpper && isUpper( token[ i ] );
+      hasVowel = hasVowel || contains( LATIN_VOWELS, toLower( token[ i ] ) );
+   }
+   return !hasVowel || token.size() == 1 || ( allUpper && token.size() <= 3 );
+}
+
+/**
+ * Keep what CGrammarBuilder::isValidPhrase() takes for a word: letters, digits, '_', apostrophes
+ * and multibyte UTF-8 characters, "jenkins-vr 2.0" becomes "jenkins_vr_2_0".
+ */
+static std::string nameToWord( const std::string& name )
+{
+   std::string result( name );
+   for ( size_t i = 0; i < result.size(); ++i )
+   {
+      unsigned char symbol = static_cast<unsigned char>( result[ i ] );
+      if ( symbol < 0x80 && !std::isalnum( symbol ) && symbol != '_' && symbol != '\'' )
+      {
+         result[ i ] = '_';
+      }
+   }
+   return result;
+}
+
+static std::string nameToPhones( const std::string& name )
+{
+   UStringList words;
+   UStringList tokens = splitName( decodeUtf8( name ) );
+   for ( size_t i = 0; i < tokens.size(); ++i )
+   {
+      const ustring& token = tokens[ i ];
+      if ( isDigit( token[ 0 ] ) )
+      {
+         UStringList numerals = readNumber( token );
+         words.insert( words.end(), numerals.begin(), numerals.end() );
+      }
+      else if ( isLatin( token[ 0 ] ) && isAbbreviation( token ) )
+      {
+         UStringList letters = spellLatin( token );
+         words.insert( words.end(), letters.begin(), letters.end() );
+      }
+      else if ( isLatin( token[ 0 ] ) )
+      {
+         words.push_back( transliterate( toLower( token ) ) );
+      }
+      else
+      {
+         words.push_back( toLower( token ) );
+      }
+   }
+
+   std::string result;
+   for ( size_t i = 0; i < words.size(); ++i )
+   {
+      std::vector<std::string> phones = wordToPhones( words[ i ] );
+      for ( size_t j = 0; j < phones.size(); ++j )
+      {
+         result += result.empty() ? "" : PHONE_SEPARATOR;
+         result += phones[ j ];
+      }
+   }
+   return result;
+}
+
+CRussianG2P::CRussianG2P( const std::string& cacheFile )
+   : mCache( new CPronunciationCache( cacheFile, RULES_VERSION ) )
+{
+}
+
+GraphemeToPhonemePtr CRussianG2P::create( const std::string& cacheFile )
+{
+   return GraphemeToPhonemePtr( new CRussianG2P( cacheFile ) );
+}
+
+std::string CRussianG2P::getDefaultCacheFile( void )
+{
+   return DEFAULT_CACHE_FILE;
+}
+
+CRussianG2P::~CRussianG2P( void )
+{
+}
+
+std::string CRussianG2P::getLanguage( void ) const
+{
+   return LANGUAGE;
+}
+
+GraphemePhoneme CRussianG2P::convert( const std::string& name )
+{
+   std::string phones;
+   if ( !mCache->lookup( name, phones ) )
+   {
+      phones = nameToPhones( name );
+      mCache->store( name, phones );
+   }
+   return GraphemePhoneme( nameToWord( name ), phones );
+}
+
+GraphemePhonemeList CRussianG2P::convertAll( const std::vector<std::string>& names )
+{
+   GraphemePhonemeList result;
+   result.reserve( names.size() );
+   size_t cached = mCache->size();
+   for ( size_t i = 0; i < names.size(); ++i )
+   {
+      GraphemePhoneme entry = convert( names[ i ] );
+      if ( entry.second.empty() )
+      {
+         CLogger::warning() << "Nothing to pronounce in '" << names[ i ] << "', skipped";
+         continue;
+      }
+      result.push_back( entry );
+   }
+   CLogger::debug() << "Converted " << names.size() << " names, " << ( mCache->size() - cached ) << " new";
+   return result;
+}
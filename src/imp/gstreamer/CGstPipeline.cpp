@@ -70,15 +70,22 @@ void CGstPipeline::setBusCallback( const GstBusCallback& callback )
    mCallback = callback;
 }
 
+void CGstPipeline::setBusSyncCallback( const GstBusCallback& callback )
+{
+   mSyncCallback = callback;
+}
+
 void CGstPipeline::addBusWatch( void )
 {
    GstPipeline* pipeline = GST_PIPELINE( raw() );
    mBus = GstBusPtr( gst_pipeline_get_bus( pipeline ), &CGstPipeline::deallocateBus );
    gst_bus_add_watch( mBus.get(), busCallback, this );
+   gst_bus_set_sync_handler( mBus.get(), busSyncCallback, this, NULL );
 }
 
 void CGstPipeline::deallocateBus( GstBus* bus )
 {
+   gst_bus_set_sync_handler( bus, NULL, NULL, NULL );
    gst_bus_remove_watch( bus );
    gst_object_unref( bus );
 }
@@ -92,4 +99,15 @@ gboolean CGstPipeline::busCallback( GstBus* bus, GstMessage* message, gpointer u
    }
    // always return TRUE. Otherwise, GLIB will delete this handler
    return TRUE;
-}
\ No newline at end of file
+}
+
+GstBusSyncReply CGstPipeline::busSyncCallback( GstBus* bus, GstMessage* message, gpointer user_data )
+{
+   CGstPipeline* pipeline = reinterpret_cast<CGstPipeline*>( user_data );
+   if ( pipeline->mSyncCallback )
+   {
+      pipeline->mSyncCallback( bus, message );
+   }
+   // the message still goes to the bus callback
+   return GST_BUS_PASS;
+}
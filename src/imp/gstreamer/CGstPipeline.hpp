@@ -47,6 +47,13 @@ public:
     */
    void setBusCallback( const GstBusCallback& callback );
 
+   /**
+    * Set the function to inspect messages synchronously, in the thread that posts them
+    * (usually the streaming thread), before they are queued for the bus callback.
+    * Set it before the pipeline starts.
+    */
+   void setBusSyncCallback( const GstBusCallback& callback );
+
 private:
    /**
     * Helper function to regiser the bus callback.
@@ -64,6 +71,11 @@ private:
     */
    static gboolean busCallback( GstBus* bus, GstMessage* message, gpointer user_data );
 
+   /**
+    * Static bus sync handler that redirects calls to the user specified sync callback function.
+    */
+   static GstBusSyncReply busSyncCallback( GstBus* bus, GstMessage* message, gpointer user_data );
+
    /**
     * Deallocator for the GstBus raw pointer.
     */
@@ -71,4 +83,5 @@ private:
 private:
    GstBusPtr mBus;
    GstBusCallback mCallback;
+   GstBusCallback mSyncCallback;
 };
\ No newline at end of file
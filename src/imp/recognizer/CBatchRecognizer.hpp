@@ -0,0 +1,99 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CBatchRecognizer.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Offline recognizer for WAV corpora
+ ************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <api/IRecognizer.hpp>
+
+class CDecoder;
+
+/**
+ * Result of decoding one file.
+ */
+struct BatchRecognitionResult
+{
+   std::string file;       ///< Path to the decoded file
+   bool status;            ///< Status of the operation
+   std::string error;      ///< Error description if status is false
+   std::string text;       ///< Recognized text
+   double confidence;      ///< Posterior probability of the hypothesis [0..1]
+   double duration;        ///< Audio duration, seconds
+   double cpuTime;         ///< CPU time the worker thread spent on decoding, seconds
+   double realTimeFactor;  ///< cpuTime / duration
+
+   explicit BatchRecognitionResult( const std::string& _file = std::string() )
+      : file( _file )
+      , status( false )
+      , error()
+      , text()
+      , confidence( 0.0 )
+      , duration( 0.0 )
+      , cpuTime( 0.0 )
+      , realTimeFactor( 0.0 )
+   {
+
+   }
+};
+
+typedef std::vector<BatchRecognitionResult> BatchRecognitionResultList;
+
+/**
+ * Decodes WAV files in parallel without GStreamer.
+ * Each worker thread owns one decoder from the pool, decoders are configured
+ * the same way as the live recognizer: dictionary, key phrase file and grammar of the language.
+ * Files must be 16 kHz 16 bit mono PCM.
+ */
+class CBatchRecognizer: boost::noncopyable
+{
+public:
+   /**
+    * @param language - language pack name, for example "ru-RU"
+    * @param mode - search to decode the files with
+    * @param threads - number of decoders in the pool, 0 means one per CPU core
+    */
+   CBatchRecognizer( const std::string& language,
+      api::asr::RecognizerMode::eRecognizerMode mode = api::asr::RecognizerMode::GRAMMAR_SEARCH,
+      unsigned int threads = 0 );
+   ~CBatchRecognizer( void );
+
+   /**
+    * Decode all *.wav files in the directory and its subdirectories.
+    */
+   BatchRecognitionResultList decodeDirectory( const std::string& directory );
+
+   /**
+    * Decode files listed in the manifest, one path per line.
+    * Relative paths are resolved against the manifest location, lines starting with '#' are ignored.
+    */
+   BatchRecognitionResultList decodeManifest( const std::string& manifestFile );
+
+   /**
+    * Decode specified files. Results are in the same order as files.
+    */
+   BatchRecognitionResultList decodeFiles( const std::vector<std::string>& files );
+
+   /**
+    * Get the number of decoders in the pool.
+    */
+   size_t getPoolSize( void ) const;
+
+private:
+   typedef boost::shared_ptr<CDecoder> DecoderPtr;
+
+   void decodeFile( CDecoder& decoder, BatchRecognitionResult& result );
+
+private:
+   std::vector<DecoderPtr> mDecoders;
+   boost::mutex mQueueGuard;
+};
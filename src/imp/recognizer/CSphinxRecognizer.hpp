@@ -8,16 +8,30 @@
  ************************************************************************/
 #pragma once
 
+#include <map>
+#include <set>
+#include <boost/weak_ptr.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <api/IRecognizer.hpp>
+#include <api/IGraphemeToPhoneme.hpp>
+#include "imp/recognizer/private/CRecognizerMetrics.hpp"
+#include "imp/recognizer/private/CProfileGovernor.hpp"
 
 class CGstRecognizerPipeline;
+class CLanguagePipelineCache;
+struct HypothesisData;
 
 class CSphinxRecognizer: public api::asr::IRecognizer, boost::noncopyable
 {
-   CSphinxRecognizer( void );
+   explicit CSphinxRecognizer( size_t residentLanguages );
 
 public:
-   static api::asr::RecognizerPtr create( void );
+   /**
+    * @param residentLanguages - how many languages stay loaded for the fast setLanguage()
+    */
+   static api::asr::RecognizerPtr create( size_t residentLanguages = 2 );
 
 public:
 
@@ -33,6 +47,26 @@ public:
     */
    virtual void setLanguage( const std::string& language );
 
+   /**
+    * @sa api::asr::IRecognizer::preloadLanguage()
+    */
+   virtual void preloadLanguage( const std::string& language );
+
+   /**
+    * @sa api::asr::IRecognizer::getAvailableLanguages()
+    */
+   virtual std::vector<std::string> getAvailableLanguages( void ) const;
+
+   /**
+    * @sa api::asr::IRecognizer::setParallelLanguages()
+    */
+   virtual bool setParallelLanguages( const std::vector<std::string>& languages );
+
+   /**
+    * @sa api::asr::IRecognizer::getParallelLanguages()
+    */
+   virtual std::vector<std::string> getParallelLanguages( void ) const;
+
    /**
     * @sa api::asr::IRecognizer::getMode()
     */
@@ -63,6 +97,36 @@ public:
     */
    virtual bool phonetize( const std::string& group, const api::asr::GraphemePhonemeList& g2pList );
 
+   /**
+    * @sa api::asr::IRecognizer::phonetizeNames()
+    */
+   virtual bool phonetizeNames( const std::string& group, const std::vector<std::string>& names );
+
+   /**
+    * @sa api::asr::IRecognizer::setKeyPhrases()
+    */
+   virtual bool setKeyPhrases( const api::asr::KeyPhraseList& phrases );
+
+   /**
+    * @sa api::asr::IRecognizer::setDecoderProfile()
+    */
+   virtual bool setDecoderProfile( api::asr::RecognizerMode::eRecognizerMode mode, const std::string& profile );
+
+   /**
+    * @sa api::asr::IRecognizer::getDecoderProfile()
+    */
+   virtual std::string getDecoderProfile( api::asr::RecognizerMode::eRecognizerMode mode ) const;
+
+   /**
+    * @sa api::asr::IRecognizer::setProfileGovernor()
+    */
+   virtual void setProfileGovernor( double maxRealTimeFactor );
+
+   /**
+    * @sa api::asr::IRecognizer::setEndpointHangover()
+    */
+   virtual bool setEndpointHangover( api::asr::RecognizerMode::eRecognizerMode mode, unsigned int milliseconds );
+
    /**
     * @sa api::asr::IRecognizer::onStartListening()
     */
@@ -73,6 +137,37 @@ public:
     */
    virtual signals::connection onRecognitionResult( const api::asr::RecognitionResultSignal_t::slot_type& slot );
 
+   /**
+    * @sa api::asr::IRecognizer::onPartialResult()
+    */
+   virtual signals::connection onPartialResult( const api::asr::PartialResultSignal_t::slot_type& slot );
+
+   /**
+    * @sa api::asr::IRecognizer::setPartialResultInterval()
+    */
+   virtual void setPartialResultInterval( unsigned int milliseconds );
+
+   /**
+    * @sa api::asr::IRecognizer::setNBestSize()
+    */
+   virtual void setNBestSize( size_t count );
+
+   /**
+    * @sa api::asr::IRecognizer::getMetricsHistogram()
+    */
+   virtual api::asr::MetricsHistogram getMetricsHistogram( api::asr::UtteranceMetric::eUtteranceMetric metric,
+      api::asr::RecognizerMode::eRecognizerMode mode ) const;
+
+   /**
+    * @sa api::asr::IRecognizer::dumpMetrics()
+    */
+   virtual void dumpMetrics( void ) const;
+
+   /**
+    * @sa api::asr::IRecognizer::getLoadTiming()
+    */
+   virtual api::asr::LanguageLoadTiming getLoadTiming( void ) const;
+
    /**
     * @sa api::asr::IRecognizer::onStopListening()
     */
@@ -81,12 +176,72 @@ private:
 
    void reinit( void );
 
+   /**
+    * Get the pipeline cache key of the current language or languages.
+    */
+   std::string getPipelineKey( void ) const;
+
+   /**
+    * Add the phonetized groups of the language to its dictionary and grammar.
+    * @param newWords - number of words added to the dictionary
+    */
+   bool applyGroups( const std::string& language, size_t& newWords );
+
+   /**
+    * Set the key phrases of the language, the language pack ones if there are no custom phrases.
+    */
+   bool applyKeyPhrases( const std::string& language );
+
+   /**
+    * Remember the key phrases of the language, the command mode reports them as KEY_WORD_SEARCH results.
+    */
+   void updateBargeInPhrases( const std::string& language );
+
+   /**
+    * Request the current profile of the search from the pipeline decoders.
+    */
+   void applyProfile( api::asr::RecognizerMode::eRecognizerMode mode );
+
+   /**
+    * Let the governor step the profile of the search which decoded the utterance.
+    * @param pipeline - the pipeline which decoded it, it may be switched away from already
+    */
+   void governProfile( const boost::weak_ptr<CGstRecognizerPipeline>& pipeline, const api::asr::UtteranceMetrics& metrics );
+
+   /**
+    * Pipeline hypothesis handler, emits PartialResult and RecognitionResult signals.
+    * @param pipeline - the pipeline the handler is set to
+    */
+   void onHypothesis( const boost::weak_ptr<CGstRecognizerPipeline>& pipeline, const HypothesisData& hypothesis );
+
 private:
    typedef boost::shared_ptr<CGstRecognizerPipeline> GstRecognizerPipelinePtr;
+   typedef boost::shared_ptr<CLanguagePipelineCache> LanguagePipelineCachePtr;
+   typedef std::map<std::string, api::asr::GraphemePhonemeList> GroupMap;
    std::string mLanguage;
+   std::vector<std::string> mParallelLanguages;   ///< Empty unless several languages are recognized
    api::asr::RecognizerMode::eRecognizerMode mMode;
+   LanguagePipelineCachePtr mPipelineCache;
    GstRecognizerPipelinePtr mRecognizerPipeline;
+   std::map<std::string, GroupMap> mGroups;   ///< Phonetized groups per language
+   std::map<std::string, boost::weak_ptr<CGstRecognizerPipeline> > mPhonetizedPipelines;   ///< Pipelines which have the groups applied
+   std::map<std::string, api::asr::KeyPhraseList> mKeyPhrases;   ///< Custom key phrases per language
+   std::map<std::string, boost::weak_ptr<CGstRecognizerPipeline> > mKeyPhrasePipelines;   ///< Pipelines which have the key phrases applied
+   std::map<std::string, std::set<std::string> > mBargeInPhrases;   ///< Key phrases per language, guarded by mBargeInGuard
+   std::map<std::string, api::asr::GraphemeToPhonemePtr> mConverters;   ///< Created on the first phonetizeNames() of the language
    api::asr::StartListeningSignal_t mStartListening;
    api::asr::StopListeningSignal_t mStopListening;
    api::asr::RecognitionResultSignal_t mRecognitionResult;
+   api::asr::PartialResultSignal_t mPartialResult;
+   std::string mLastPartialText;
+   boost::chrono::steady_clock::time_point mLastPartialTime;
+   boost::chrono::milliseconds mPartialInterval;
+   size_t mNBestSize;
+   CRecognizerMetrics mMetrics;
+   std::map<int, std::string> mProfiles;   ///< Decoder profiles set per search mode
+   std::map<int, unsigned int> mEndpointHangovers;   ///< Milliseconds per search mode
+   CProfileGovernor mGovernor;
+   mutable boost::mutex mProfileGuard;
+   boost::mutex mPartialGuard;
+   boost::mutex mBargeInGuard;
 };
@@ -0,0 +1,74 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CAudioRingBuffer.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Lock-free history of the recent audio
+ ************************************************************************/
+#include <algorithm>
+#include <cstring>
+
+#include "CAudioRingBuffer.hpp"
+
+static size_t roundUpToPowerOfTwo( size_t value )
+{
+   size_t result = 1;
+   while ( result < value )
+   {
+      result <<= 1;
+   }
+   return result;
+}
+
+CAudioRingBuffer::CAudioRingBuffer( size_t capacity )
+   : mBuffer( roundUpToPowerOfTwo( std::max<size_t>( capacity, 1 ) ) )
+   , mMask( mBuffer.size() - 1 )
+   , mPosition( 0 )
+   , mReserved( 0 )
+{
+}
+
+void CAudioRingBuffer::write( const short* samples, size_t count )
+{
+   boost::uint64_t position = mPosition.load( std::memory_order_relaxed );
+   if ( count > mBuffer.size() )
+   {
+      // only the tail fits
+      position += count - mBuffer.size();
+      samples += count - mBuffer.size();
+      count = mBuffer.size();
+   }
+   // announce the samples being overwritten before touching them
+   mReserved.store( position + count, std::memory_order_relaxed );
+   std::atomic_thread_fence( std::memory_order_release );
+   size_t offset = static_cast<size_t>( position & mMask );
+   size_t firstPart = std::min( count, mBuffer.size() - offset );
+   std::memcpy( mBuffer.data() + offset, samples, firstPart * sizeof( short ) );
+   std::memcpy( mBuffer.data(), samples + firstPart, ( count - firstPart ) * sizeof( short ) );
+   // publish the samples
+   mPosition.store( position + count, std::memory_order_release );
+}
+
+boost::uint64_t CAudioRingBuffer::getPosition( void ) const
+{
+   return mPosition.load( std::memory_order_acquire );
+}
+
+bool CAudioRingBuffer::read( boost::uint64_t position, std::vector<short>& samples ) const
+{
+   boost::uint64_t end = mPosition.load( std::memory_order_acquire );
+   if ( position > end || end - position > mBuffer.size() )
+   {
+      return false;
+   }
+   size_t count = static_cast<size_t>( end - position );
+   size_t offset = static_cast<size_t>( position & mMask );
+   size_t firstPart = std::min( count, mBuffer.size() - offset );
+   samples.resize( count );
+   std::memcpy( samples.data(), mBuffer.data() + offset, firstPart * sizeof( short ) );
+   std::memcpy( samples.data() + firstPart, mBuffer.data(), ( count - firstPart ) * sizeof( short ) );
+   // the writer may have wrapped around while copying, then the head of the copy is garbage
+   std::atomic_thread_fence( std::memory_order_acquire );
+   return ( mReserved.load( std::memory_order_relaxed ) - position <= mBuffer.size() );
+}
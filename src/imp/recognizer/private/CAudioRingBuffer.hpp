@@ -0,0 +1,52 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CAudioRingBuffer.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Lock-free history of the recent audio
+ ************************************************************************/
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+/**
+ * Keeps the last samples of the audio stream.
+ * Single producer, the oldest samples are overwritten.
+ * Samples are addressed by the absolute position in the stream (number of samples written before),
+ * so readers can ask for the audio since some moment without any locking.
+ */
+class CAudioRingBuffer: boost::noncopyable
+{
+public:
+   /**
+    * @param capacity - number of samples to keep, rounded up to the power of two
+    */
+   explicit CAudioRingBuffer( size_t capacity );
+
+   /**
+    * Append samples. Only one thread may write.
+    */
+   void write( const short* samples, size_t count );
+
+   /**
+    * Get the absolute position of the next sample to be written.
+    */
+   boost::uint64_t getPosition( void ) const;
+
+   /**
+    * Copy the samples from the absolute position up to the current one.
+    * Safe to call concurrently with write().
+    * @return false if the samples at the position are already overwritten
+    */
+   bool read( boost::uint64_t position, std::vector<short>& samples ) const;
+
+private:
+   std::vector<short> mBuffer;
+   size_t mMask;
+   std::atomic<boost::uint64_t> mPosition;   ///< End of the published samples
+   std::atomic<boost::uint64_t> mReserved;   ///< End of the samples being written
+};
@@ -0,0 +1,216 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CBatchRecognizer.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Offline recognizer for WAV corpora
+ ************************************************************************/
+#include <fstream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <boost/chrono/thread_clock.hpp>
+
+#include "imp/recognizer/CBatchRecognizer.hpp"
+#include "imp/recognizer/private/CDecoder.hpp"
+#include "imp/recognizer/private/CLanguageFiles.hpp"
+#include "imp/recognizer/private/CGrammarCache.hpp"
+#include "imp/recognizer/private/CWavReader.hpp"
+#include "imp/logger/CLogger.hpp"
+
+using namespace api::asr;
+
+static const char* WAV_FILE_EXTENSION = ".wav";
+static const char* MANIFEST_COMMENT = "#";
+static const unsigned int DECODER_SAMPLE_RATE = 16000;
+static const int AUTO_SCORE_THREADS = -1;
+
+static const char* DECODER_ERROR_MSG = "Unable to create the batch decoder. Aborting.";
+static const char* RECOGNIZER_KWS_ERROR_MSG = "Unable to configure key word recognition. Aborting.";
+static const char* RECOGNIZER_VR_ERROR_MSG = "Unable to configure voice recognition. Aborting.";
+static const char* MANIFEST_ERROR_MSG = "Can't open the manifest file %1%";
+static const char* SAMPLE_RATE_ERROR_MSG = "Unsupported sample rate %1%, expected %2%";
+static const char* DECODE_ERROR_MSG = "Decoder failed to process the file";
+static const char* FILE_RESULT_MSG = "%1%: '%2%' (confidence %3$.3f, %4$.2f s, %5$.3f xRT)";
+static const char* SUMMARY_MSG = "Batch decoded %1% files (%2% failed) in %3% threads: %4$.1f s of audio, %5$.1f s CPU, %6$.3f xRT";
+
+/**
+ * TODO: make common hpp and cpp files and move utility functions to it.
+ */
+static void THROW_FATAL( const std::string&  message )
+{
+   CLogger::fatal() << message;
+   throw std::runtime_error( message );
+}
+
+static void RUN_CHECKED( bool operationResult, const std::string& errorMessage )
+{
+   if ( !operationResult )
+   {
+      THROW_FATAL( errorMessage );
+   }
+}
+
+CBatchRecognizer::CBatchRecognizer( const std::string& language, RecognizerMode::eRecognizerMode mode, unsigned int threads )
+   : mDecoders()
+{
+   if ( threads == 0 )
+   {
+      threads = std::max( 1u, boost::thread::hardware_concurrency() );
+   }
+   CLanguageFiles files( language );
+   CGrammarCache grammarCache( files );
+   // the decoders already run in parallel, scoring threads would only compete with them
+   int scoreThreads = threads > 1 ? 1 : AUTO_SCORE_THREADS;
+   for ( unsigned int i = 0; i < threads; ++i )
+   {
+      DecoderPtr decoder = CDecoder::create( files.getModelDir(), files.getDictFile(), scoreThreads );
+      RUN_CHECKED( decoder.get() != NULL, DECODER_ERROR_MSG );
+      RUN_CHECKED( decoder->setKeyFile( files.getKeyFile() ), RECOGNIZER_KWS_ERROR_MSG );
+      RUN_CHECKED( grammarCache.apply( *decoder ), RECOGNIZER_VR_ERROR_MSG );
+      RUN_CHECKED( decoder->activateMode( mode ), RECOGNIZER_VR_ERROR_MSG );
+      mDecoders.push_back( decoder );
+   }
+}
+
+CBatchRecognizer::~CBatchRecognizer( void )
+{
+}
+
+BatchRecognitionResultList CBatchRecognizer::decodeDirectory( const std::string& directory )
+{
+   namespace fs = boost::filesystem;
+   std::vector<std::string> files;
+   for ( fs::recursive_directory_iterator it( directory ), end; it != end; ++it )
+   {
+      if ( fs::is_regular_file( it->status() )
+         && boost::iequals( it->path().extension().string(), WAV_FILE_EXTENSION ) )
+      {
+         files.push_back( it->path().string() );
+      }
+   }
+   std::sort( files.begin(), files.end() );
+   return decodeFiles( files );
+}
+
+BatchRecognitionResultList CBatchRecognizer::decodeManifest( const std::string& manifestFile )
+{
+   namespace fs = boost::filesystem;
+   std::ifstream manifest( manifestFile.c_str() );
+   if ( !manifest )
+   {
+      THROW_FATAL( str( boost::format( MANIFEST_ERROR_MSG ) % manifestFile ) );
+   }
+   fs::path baseDir = fs::path( manifestFile ).parent_path();
+   std::vector<std::string> files;
+   std::string line;
+   while ( std::getline( manifest, line ) )
+   {
+      boost::trim( line );
+      if ( line.empty() || boost::starts_with( line, MANIFEST_COMMENT ) )
+      {
+         continue;
+      }
+      fs::path file( line );
+      files.push_back( ( file.is_absolute() ? file : baseDir / file ).string() );
+   }
+   return decodeFiles( files );
+}
+
+BatchRecognitionResultList CBatchRecognizer::decodeFiles( const std::vector<std::string>& files )
+{
+   BatchRecognitionResultList results;
+   results.reserve( files.size() );
+   for ( size_t i = 0; i < files.size(); ++i )
+   {
+      results.push_back( BatchRecognitionResult( files[ i ] ) );
+   }
+
+   size_t nextFile = 0;
+   boost::thread_group workers;
+   for ( size_t i = 0; i < mDecoders.size(); ++i )
+   {
+      CDecoder* decoder = mDecoders[ i ].get();
+      workers.create_thread( [this, decoder, &nextFile, &results]() {
+         for ( ;; )
+         {
+            size_t index = 0;
+            {
+               boost::lock_guard<boost::mutex> lock( mQueueGuard );
+               if ( nextFile == results.size() )
+               {
+                  break;
+               }
+               index = nextFile++;
+            }
+            decodeFile( *decoder, results[ index ] );
+         }
+      } );
+   }
+   workers.join_all();
+
+   size_t failed = 0;
+   double totalDuration = 0.0;
+   double totalCpu = 0.0;
+   for ( size_t i = 0; i < results.size(); ++i )
+   {
+      failed += results[ i ].status ? 0 : 1;
+      totalDuration += results[ i ].duration;
+      totalCpu += results[ i ].cpuTime;
+   }
+   CLogger::info() << str( boost::format( SUMMARY_MSG ) % results.size() % failed % mDecoders.size()
+      % totalDuration % totalCpu % ( totalDuration > 0.0 ? totalCpu / totalDuration : 0.0 ) );
+   return results;
+}
+
+size_t CBatchRecognizer::getPoolSize( void ) const
+{
+   return mDecoders.size();
+}
+
+void CBatchRecognizer::decodeFile( CDecoder& decoder, BatchRecognitionResult& result )
+{
+   CWavReader reader;
+   if ( !reader.read( result.file ) )
+   {
+      result.error = reader.getError();
+   }
+   else if ( reader.getSampleRate() != DECODER_SAMPLE_RATE )
+   {
+      result.error = str( boost::format( SAMPLE_RATE_ERROR_MSG ) % reader.getSampleRate() % DECODER_SAMPLE_RATE );
+   }
+   else
+   {
+      const std::vector<short>& samples = reader.getSamples();
+      // the decoder timer counts the CPU time of the whole process, the other workers included
+      boost::chrono::thread_clock::time_point start = boost::chrono::thread_clock::now();
+      bool decoded = decoder.startUtterance();
+      decoded = decoded && ( samples.empty() || decoder.processRaw( &samples[ 0 ], samples.size(), true ) );
+      decoded = decoder.endUtterance() && decoded;
+      if ( decoded )
+      {
+         result.status = true;
+         result.text = decoder.getHypothesis();
+         result.confidence = decoder.getConfidence();
+         result.duration = reader.getDuration();
+         result.cpuTime = boost::chrono::duration<double>( boost::chrono::thread_clock::now() - start ).count();
+         result.realTimeFactor = ( result.duration > 0.0 ) ? result.cpuTime / result.duration : 0.0;
+      }
+      else
+      {
+         result.error = DECODE_ERROR_MSG;
+      }
+   }
+
+   if ( result.status )
+   {
+      CLogger::debug() << str( boost::format( FILE_RESULT_MSG ) % result.file % result.text
+         % result.confidence % result.duration % result.realTimeFactor );
+   }
+   else
+   {
+      CLogger::warning() << result.file << ": " << result.error;
+   }
+}
@@ -7,23 +7,129 @@
  * @brief   Pocketsphinx decoder wrapper
  ************************************************************************/
 #include <boost/assign.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
 #include <map>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <sphinxbase/jsgf.h>
+#include <sphinxbase/fsg_model.h>
+#include <sphinxbase/ckd_alloc.h>
+
 #include "CDecoder.hpp"
+#include "CNBestList.hpp"
 
 typedef std::map<int, const char*> SearchModeToNameMap;
 
 static const char* KW_SEARCH = "_kws";
 static const char* GRAMMAR_SEARCH = "grammar";
 static const char* NULL_SEARCH = "null";
+static const char* LANGUAGE_WEIGHT_PARAM = "-lw";
+static const char* FRAME_RATE_PARAM = "-frate";
+static const char* MAX_HMMS_PARAM = "-maxhmmpf";
+static const char* BEAM_PARAM = "-beam";
+static const char* WORD_BEAM_PARAM = "-wbeam";
+static const char* PHONE_BEAM_PARAM = "-pbeam";
+static const char* MODEL_DIR_PARAM = "-hmm";
+static const char* DICT_PARAM = "-dict";
+// pocketsphinx maps the binary model files (sendump, binary mdef) instead of reading them;
+// it is also its default, so the decoders of the GStreamer elements map them as well
+static const char* MMAP_PARAM = "-mmap";
+static const char* MMAP_ENABLED = "yes";
+static const char* SCORE_THREADS_PARAM = "-scorethreads";
+static const char* DEFAULT_PROFILE = "command";
+static const char* KEY_LIST_PATTERN = "jenkins-vr-%%%%-%%%%-%%%%.key";
+static const char* ALTERNATIVE_WORD_PATTERN = "%1%(%2%)";
+// pocketsphinx numbers alternative pronunciations from 2
+static const int FIRST_ALTERNATIVE = 2;
+static const int MAX_PRONUNCIATIONS = 10;
+
+/**
+ * The pocketsphinx default, a tighter limit trades accuracy for speed and is left to the other profiles
+ */
+static const int DEFAULT_MAX_ACTIVE_HMMS = 30000;
+
+/**
+ * Pruning settings a search is created with
+ */
+struct SearchProfile
+{
+   const char* name;
+   double beam;        ///< HMM pruning, the keyword search uses only this one
+   double wordBeam;    ///< Word exit pruning
+   double phoneBeam;   ///< Phone transition pruning
+   int maxActiveHmms;  ///< -1 is no limit
+};
+
+/**
+ * From the cheapest to the most accurate one, "command" keeps the pocketsphinx defaults
+ */
+static const SearchProfile PROFILES[] =
+{
+   { "idle-kws", 1e-30, 1e-20, 1e-30, 1000 },
+   { "command", 1e-48, 7e-29, 1e-48, DEFAULT_MAX_ACTIVE_HMMS },
+   { "accurate", 1e-64, 1e-40, 1e-64, -1 }
+};
+
+static const SearchProfile* findProfile( const std::string& name )
+{
+   for ( size_t i = 0; i < sizeof( PROFILES ) / sizeof( PROFILES[ 0 ] ); ++i )
+   {
+      if ( name == PROFILES[ i ].name )
+      {
+         return &PROFILES[ i ];
+      }
+   }
+   return NULL;
+}
+
+static const size_t MAX_PATHS_PER_ALTERNATIVE = 10;   ///< Paths differing only in fillers give the same text
 
 static SearchModeToNameMap ModeToNameMap = boost::assign::map_list_of( api::asr::RecognizerMode::KEY_WORD_SEARCH, KW_SEARCH )
    ( api::asr::RecognizerMode::GRAMMAR_SEARCH, GRAMMAR_SEARCH );
 
 
 CDecoder::CDecoder( ps_decoder_t* decoder )
+   : mUtteranceStarts( 0 )
 {
    assert( decoder != NULL );
    mDecoder = decoder;
+   initProfiles();
+}
+
+void CDecoder::initProfiles( void )
+{
+   mProfiles[ api::asr::RecognizerMode::KEY_WORD_SEARCH ] = DEFAULT_PROFILE;
+   mProfiles[ api::asr::RecognizerMode::GRAMMAR_SEARCH ] = DEFAULT_PROFILE;
+}
+
+DecoderPtr CDecoder::create( const std::string& modelDir, const std::string& dictFile, int scoreThreads )
+{
+   DecoderPtr result;
+   cmd_ln_t* config = cmd_ln_init( NULL, ps_args(), TRUE,
+      MODEL_DIR_PARAM, modelDir.c_str(),
+      DICT_PARAM, dictFile.c_str(),
+      MMAP_PARAM, MMAP_ENABLED,
+      NULL );
+   if ( config == NULL )
+   {
+      return result;
+   }
+   if ( cmd_ln_exists_r( config, SCORE_THREADS_PARAM ) )
+   {
+      cmd_ln_set_int32_r( config, SCORE_THREADS_PARAM, scoreThreads );
+   }
+   ps_decoder_t* decoder = ps_init( config );
+   cmd_ln_free_r( config );
+   if ( decoder != NULL )
+   {
+      result.reset( new CDecoder( decoder ) );
+   }
+   return result;
 }
 
 CDecoder::~CDecoder( void )
@@ -35,12 +141,67 @@ CDecoder::~CDecoder( void )
 
 bool CDecoder::setKeyFile( const std::string& keyFile )
 {
-   return ( ps_set_kws( mDecoder, KW_SEARCH, keyFile.c_str() ) == 0 );
+   bool result = setKeyList( keyFile );
+   if ( result )
+   {
+      mKeyFile = keyFile;
+      mKeyPhrases.clear();
+   }
+   return result;
+}
+
+bool CDecoder::setKeyList( const std::string& listFile )
+{
+   configureSearch( api::asr::RecognizerMode::KEY_WORD_SEARCH );
+   return ( ps_set_kws( mDecoder, KW_SEARCH, listFile.c_str() ) == 0 );
+}
+
+bool CDecoder::setKeyPhrases( const api::asr::KeyPhraseList& phrases )
+{
+   if ( phrases.empty() )
+   {
+      return false;
+   }
+   // pocketsphinx reads the phrases with their thresholds from a list file only
+   boost::system::error_code error;
+   boost::filesystem::path listFile = boost::filesystem::temp_directory_path( error ) / boost::filesystem::unique_path( KEY_LIST_PATTERN );
+   {
+      std::ofstream list( listFile.string().c_str() );
+      for ( size_t i = 0; i < phrases.size(); ++i )
+      {
+         list << phrases[ i ].phrase;
+         if ( phrases[ i ].threshold > 0.0 )
+         {
+            list << " /" << phrases[ i ].threshold << "/";
+         }
+         list << "\n";
+      }
+      if ( !list )
+      {
+         return false;
+      }
+   }
+   bool result = setKeyList( listFile.string() );
+   boost::filesystem::remove( listFile, error );
+   if ( result )
+   {
+      // the list file is gone, the phrases rebuild the search for another profile
+      mKeyFile.clear();
+      mKeyPhrases = phrases;
+   }
+   return result;
 }
 
 bool CDecoder::setKeyPhrase( const std::string& keyPhrase )
 {
-   return ( ps_set_keyphrase( mDecoder, KW_SEARCH, keyPhrase.c_str() ) == 0 );
+   configureSearch( api::asr::RecognizerMode::KEY_WORD_SEARCH );
+   bool result = ( ps_set_keyphrase( mDecoder, KW_SEARCH, keyPhrase.c_str() ) == 0 );
+   if ( result )
+   {
+      mKeyFile.clear();
+      mKeyPhrases.assign( 1, api::asr::KeyPhrase( keyPhrase ) );
+   }
+   return result;
 }
 
 bool CDecoder::addWordToDict( const api::asr::GraphemePhoneme& wordAndTranscript, bool updateDict )
@@ -48,23 +209,409 @@ bool CDecoder::addWordToDict( const api::asr::GraphemePhoneme& wordAndTranscript
    return ( ps_add_word( mDecoder, wordAndTranscript.first.c_str(), wordAndTranscript.second.c_str(), updateDict ) == 0 );
 }
 
+size_t CDecoder::addWordsToDict( const api::asr::GraphemePhonemeList& g2pList )
+{
+   size_t result = 0;
+   for ( size_t i = 0; i < g2pList.size(); ++i )
+   {
+      const std::string& word = g2pList[ i ].first;
+      std::string phones = boost::algorithm::join( splitPhones( g2pList[ i ].second ), " " );
+      // pocketsphinx refuses to redefine a word, a changed pronunciation goes in as "word(2)" and so on
+      std::string name = word;
+      for ( int n = FIRST_ALTERNATIVE; n <= MAX_PRONUNCIATIONS && hasWord( name ); ++n )
+      {
+         if ( getPronunciation( name ) == phones )
+         {
+            name.clear();
+            break;
+         }
+         name = str( boost::format( ALTERNATIVE_WORD_PATTERN ) % word % n );
+      }
+      if ( !name.empty() && !hasWord( name ) && addWordToDict( api::asr::GraphemePhoneme( name, phones ), false ) )
+      {
+         ++result;
+      }
+   }
+   return result;
+}
+
+bool CDecoder::hasWord( const std::string& word )
+{
+   char* phones = ps_lookup_word( mDecoder, word.c_str() );
+   ckd_free( phones );
+   return ( phones != NULL );
+}
+
+std::string CDecoder::getPronunciation( const std::string& word )
+{
+   char* phones = ps_lookup_word( mDecoder, word.c_str() );
+   std::string result = ( phones != NULL ) ? phones : "";
+   ckd_free( phones );
+   return boost::algorithm::join( splitPhones( result ), " " );
+}
+
+std::vector<std::string> CDecoder::splitPhones( const std::string& phones )
+{
+   std::vector<std::string> result;
+   boost::algorithm::split( result, phones, boost::algorithm::is_space(), boost::algorithm::token_compress_on );
+   result.erase( std::remove( result.begin(), result.end(), std::string() ), result.end() );
+   return result;
+}
+
 bool CDecoder::setGrammar( const std::string& grammarCode )
 {
+   configureSearch( api::asr::RecognizerMode::GRAMMAR_SEARCH );
    return ( ps_set_jsgf_string( mDecoder, GRAMMAR_SEARCH, grammarCode.c_str() ) == 0 );
 }
 
 bool CDecoder::setGrammarFile( const std::string& grammarFile )
 {
+   configureSearch( api::asr::RecognizerMode::GRAMMAR_SEARCH );
    return ( ps_set_jsgf_file( mDecoder, GRAMMAR_SEARCH, grammarFile.c_str() ) == 0 );
 }
 
+bool CDecoder::setProfile( api::asr::RecognizerMode::eRecognizerMode mode, const std::string& profile )
+{
+   if ( findProfile( profile ) == NULL || mProfiles.find( mode ) == mProfiles.end() )
+   {
+      return false;
+   }
+   if ( mProfiles[ mode ] == profile )
+   {
+      return true;
+   }
+   bool isActive = ( getActiveMode() == mode );
+   if ( isActive && isInSpeech() )
+   {
+      return false;
+   }
+   mProfiles[ mode ] = profile;
+   // the search is recreated, the active one has to be set again outside of an utterance
+   bool inUtterance = isActive && endUtterance();
+   bool result = rebuildSearch( mode );
+   if ( isActive )
+   {
+      result = activateMode( mode ) && result;
+   }
+   if ( inUtterance )
+   {
+      result = startUtterance() && result;
+   }
+   return result;
+}
+
+std::string CDecoder::getProfile( api::asr::RecognizerMode::eRecognizerMode mode ) const
+{
+   std::map<int, std::string>::const_iterator it = mProfiles.find( mode );
+   return ( it != mProfiles.end() ) ? it->second : std::string();
+}
+
+std::vector<std::string> CDecoder::getProfileNames( void )
+{
+   std::vector<std::string> result;
+   for ( size_t i = 0; i < sizeof( PROFILES ) / sizeof( PROFILES[ 0 ] ); ++i )
+   {
+      result.push_back( PROFILES[ i ].name );
+   }
+   return result;
+}
+
+void CDecoder::configureSearch( api::asr::RecognizerMode::eRecognizerMode mode )
+{
+   // the searches read their pruning settings from the decoder config when they are created
+   const SearchProfile* profile = findProfile( getProfile( mode ) );
+   cmd_ln_t* config = ps_get_config( mDecoder );
+   cmd_ln_set_float_r( config, BEAM_PARAM, profile->beam );
+   cmd_ln_set_float_r( config, WORD_BEAM_PARAM, profile->wordBeam );
+   cmd_ln_set_float_r( config, PHONE_BEAM_PARAM, profile->phoneBeam );
+   cmd_ln_set_int32_r( config, MAX_HMMS_PARAM, profile->maxActiveHmms );
+}
+
+bool CDecoder::rebuildSearch( api::asr::RecognizerMode::eRecognizerMode mode )
+{
+   if ( mode == api::asr::RecognizerMode::KEY_WORD_SEARCH )
+   {
+      if ( !mKeyFile.empty() )
+      {
+         return setKeyFile( mKeyFile );
+      }
+      // nothing to rebuild if the search is not set yet
+      return mKeyPhrases.empty() || setKeyPhrases( mKeyPhrases );
+   }
+   fsg_model_t* fsg = ps_get_fsg( mDecoder, GRAMMAR_SEARCH );
+   if ( fsg == NULL )
+   {
+      return true;
+   }
+   // the new search takes the grammar of the old one, which frees it on replacement
+   fsg_model_retain( fsg );
+   configureSearch( mode );
+   bool result = ( ps_set_fsg( mDecoder, GRAMMAR_SEARCH, fsg ) == 0 );
+   fsg_model_free( fsg );
+   return result;
+}
+
+bool CDecoder::setGrammarFsgFile( const std::string& fsgFile )
+{
+   bool result = false;
+   fsg_model_t* fsg = fsg_model_readfile( fsgFile.c_str(), ps_get_logmath( mDecoder ), getLanguageWeight() );
+   if ( fsg != NULL )
+   {
+      configureSearch( api::asr::RecognizerMode::GRAMMAR_SEARCH );
+      result = ( ps_set_fsg( mDecoder, GRAMMAR_SEARCH, fsg ) == 0 );
+      fsg_model_free( fsg );
+   }
+   return result;
+}
+
+bool CDecoder::compileGrammarFile( const std::string& grammarFile, const std::string& fsgFile )
+{
+   return compileJsgf( jsgf_parse_file( grammarFile.c_str(), NULL ), fsgFile );
+}
+
+bool CDecoder::compileGrammar( const std::string& grammarCode, const std::string& fsgFile )
+{
+   return compileJsgf( jsgf_parse_string( grammarCode.c_str(), NULL ), fsgFile );
+}
+
+bool CDecoder::compileJsgf( jsgf_t* jsgf, const std::string& fsgFile )
+{
+   bool result = false;
+   if ( jsgf != NULL )
+   {
+      // the same rule ps_set_jsgf_file() picks when -toprule is not set
+      jsgf_rule_t* rule = jsgf_get_public_rule( jsgf );
+      fsg_model_t* fsg = ( rule != NULL ) ? jsgf_build_fsg( jsgf, rule, ps_get_logmath( mDecoder ), getLanguageWeight() ) : NULL;
+      if ( fsg != NULL )
+      {
+         configureSearch( api::asr::RecognizerMode::GRAMMAR_SEARCH );
+         result = ( ps_set_fsg( mDecoder, GRAMMAR_SEARCH, fsg ) == 0 );
+         FILE* file = fopen( fsgFile.c_str(), "w" );
+         if ( file != NULL )
+         {
+            fsg_model_write( fsg, file );
+            fclose( file );
+         }
+         fsg_model_free( fsg );
+      }
+      jsgf_grammar_free( jsgf );
+   }
+   return result;
+}
+
 bool CDecoder::activateMode( api::asr::RecognizerMode::eRecognizerMode mode )
 {
    return ( ps_set_search( mDecoder, ModeToNameMap[ mode ] ) == 0 );
 }
 
+api::asr::RecognizerMode::eRecognizerMode CDecoder::getActiveMode( void )
+{
+   const char* search = ps_get_search( mDecoder );
+   for ( SearchModeToNameMap::const_iterator it = ModeToNameMap.begin(); search != NULL && it != ModeToNameMap.end(); ++it )
+   {
+      if ( strcmp( it->second, search ) == 0 )
+      {
+         return static_cast<api::asr::RecognizerMode::eRecognizerMode>( it->first );
+      }
+   }
+   return api::asr::RecognizerMode::NONE;
+}
+
+bool CDecoder::switchModeLive( api::asr::RecognizerMode::eRecognizerMode mode )
+{
+   if ( isInSpeech() )
+   {
+      return false;
+   }
+   // the owner of the stream may have just finished the utterance and not started the next one yet,
+   // in this case it starts the utterance itself with the new search
+   bool inUtterance = endUtterance();
+   bool result = activateMode( mode );
+   if ( inUtterance )
+   {
+      result = startUtterance() && result;
+   }
+   return result;
+}
+
+bool CDecoder::isInSpeech( void )
+{
+   return ( ps_get_in_speech( mDecoder ) != 0 );
+}
+
+bool CDecoder::startUtterance( void )
+{
+   bool result = ( ps_start_utt( mDecoder ) == 0 );
+   mUtteranceStarts += result ? 1 : 0;
+   return result;
+}
+
+size_t CDecoder::getUtteranceStarts( void ) const
+{
+   return mUtteranceStarts;
+}
+
 bool CDecoder::endUtterance( void )
 {
    return ( ps_end_utt( mDecoder ) == 0 );
 }
 
+bool CDecoder::processRaw( const short* samples, size_t count, bool fullUtterance )
+{
+   return ( ps_process_raw( mDecoder, samples, count, FALSE, fullUtterance ? TRUE : FALSE ) >= 0 );
+}
+
+std::string CDecoder::getHypothesis( void )
+{
+   int32 score = 0;
+   const char* hyp = ps_get_hyp( mDecoder, &score );
+   return ( hyp != NULL ) ? std::string( hyp ) : std::string();
+}
+
+double CDecoder::getConfidence( void )
+{
+   return logmath_exp( ps_get_logmath( mDecoder ), ps_get_prob( mDecoder ) );
+}
+
+long CDecoder::getRawConfidence( void )
+{
+   return ps_get_prob( mDecoder );
+}
+
+int CDecoder::getHypothesisEndFrame( void )
+{
+   int result = -1;
+   for ( ps_seg_t* seg = ps_seg_iter( mDecoder ); seg != NULL; seg = ps_seg_next( seg ) )
+   {
+      int startFrame = 0;
+      int endFrame = 0;
+      ps_seg_frames( seg, &startFrame, &endFrame );
+      result = std::max( result, endFrame );
+   }
+   return result;
+}
+
+/**
+ * Check whether the segment is a real word, not a silence or a filler.
+ */
+static bool isRealWord( const char* word )
+{
+   return ( word != NULL && word[ 0 ] != '<' && word[ 0 ] != '[' );
+}
+
+static size_t countWords( ps_seg_t* seg )
+{
+   size_t result = 0;
+   for ( ; seg != NULL; seg = ps_seg_next( seg ) )
+   {
+      result += isRealWord( ps_seg_word( seg ) ) ? 1 : 0;
+   }
+   return result;
+}
+
+static void copyWords( ps_seg_t* seg, CUtteranceArena& arena, api::asr::RecognitionWord* words, double frameRate )
+{
+   for ( ; seg != NULL; seg = ps_seg_next( seg ) )
+   {
+      const char* word = ps_seg_word( seg );
+      if ( !isRealWord( word ) )
+      {
+         continue;
+      }
+      // drop the pronunciation variant suffix: "word(2)"
+      const char* variant = strchr( word, '(' );
+      int startFrame = 0;
+      int endFrame = 0;
+      ps_seg_frames( seg, &startFrame, &endFrame );
+      words->text = arena.copyString( word, ( variant != NULL ) ? variant - word : strlen( word ) );
+      words->startTime = startFrame / frameRate;
+      words->endTime = ( endFrame + 1 ) / frameRate;
+      ++words;
+   }
+}
+
+api::asr::NBestListPtr CDecoder::getNBest( size_t count )
+{
+   api::asr::NBestListPtr result;
+   if ( count == 0 )
+   {
+      return result;
+   }
+   UtteranceArenaPtr arena = CUtteranceArena::acquire();
+   api::asr::RecognitionAlternative* alternatives = arena->allocateArray<api::asr::RecognitionAlternative>( count );
+   double frameRate = getFrameRate();
+   size_t size = 0;
+   ps_nbest_t* nbest = ps_nbest( mDecoder );
+   for ( size_t paths = 0; nbest != NULL; ++paths )
+   {
+      if ( size == count || paths == count * MAX_PATHS_PER_ALTERNATIVE )
+      {
+         ps_nbest_free( nbest );
+         break;
+      }
+      int32 score = 0;
+      const char* hyp = ps_nbest_hyp( nbest, &score );
+      bool isDuplicate = ( hyp == NULL );
+      for ( size_t i = 0; !isDuplicate && i < size; ++i )
+      {
+         isDuplicate = ( strcmp( alternatives[ i ].text, hyp ) == 0 );
+      }
+      if ( !isDuplicate )
+      {
+         api::asr::RecognitionAlternative& alternative = alternatives[ size++ ];
+         alternative.text = arena->copyString( hyp, strlen( hyp ) );
+         alternative.score = score;
+         alternative.wordCount = countWords( ps_nbest_seg( nbest ) );
+         api::asr::RecognitionWord* words = arena->allocateArray<api::asr::RecognitionWord>( alternative.wordCount );
+         copyWords( ps_nbest_seg( nbest ), *arena, words, frameRate );
+         alternative.words = words;
+      }
+      nbest = ps_nbest_next( nbest );
+   }
+   if ( size == 0 )
+   {
+      // searches without a lattice (keyword spotting) have the best hypothesis only
+      int32 score = 0;
+      const char* hyp = ps_get_hyp( mDecoder, &score );
+      if ( hyp != NULL )
+      {
+         api::asr::RecognitionAlternative& alternative = alternatives[ size++ ];
+         alternative.text = arena->copyString( hyp, strlen( hyp ) );
+         alternative.score = score;
+         alternative.wordCount = countWords( ps_seg_iter( mDecoder ) );
+         api::asr::RecognitionWord* words = arena->allocateArray<api::asr::RecognitionWord>( alternative.wordCount );
+         copyWords( ps_seg_iter( mDecoder ), *arena, words, frameRate );
+         alternative.words = words;
+      }
+   }
+   if ( size > 0 )
+   {
+      result.reset( new CNBestList( arena, alternatives, size ) );
+   }
+   return result;
+}
+
+int CDecoder::getFrameCount( void )
+{
+   return ps_get_n_frames( mDecoder );
+}
+
+int CDecoder::getFrameRate( void )
+{
+   return cmd_ln_int32_r( ps_get_config( mDecoder ), FRAME_RATE_PARAM );
+}
+
+double CDecoder::getUtteranceDuration( void )
+{
+   double speech = 0.0;
+   double cpu = 0.0;
+   double wall = 0.0;
+   ps_get_utt_time( mDecoder, &speech, &cpu, &wall );
+   return speech;
+}
+
+
+float32 CDecoder::getLanguageWeight( void )
+{
+   return cmd_ln_float32_r( ps_get_config( mDecoder ), LANGUAGE_WEIGHT_PARAM );
+}
@@ -9,10 +9,17 @@
 #pragma once
 
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <map>
 #include <string>
+#include <vector>
 
 #include <api/IRecognizer.hpp>
 #include <pocketsphinx.h>
+#include <sphinxbase/jsgf.h>
+
+class CDecoder;
+typedef boost::shared_ptr<CDecoder> DecoderPtr;
 
 class CDecoder: boost::noncopyable
 {
@@ -20,14 +27,195 @@ public:
    CDecoder( ps_decoder_t* decoder );
    ~CDecoder( void );
 
+   /**
+    * Create a standalone decoder (not owned by any GStreamer element).
+    * @param modelDir - path to the directory with an acoustic model files
+    * @param dictFile - path to the pronunciation dictionary
+    * @param scoreThreads - threads scoring the senones of a frame, -1 for one per CPU core.
+    *                       Ignored by a pocketsphinx built without libs/mgau_pool.patch
+    * @return decoder or empty pointer if pocketsphinx failed to initialize
+    */
+   static DecoderPtr create( const std::string& modelDir, const std::string& dictFile, int scoreThreads );
+
    bool setKeyPhrase( const std::string& keyPhrase );
    bool setKeyFile( const std::string& keyFile );
+
+   /**
+    * Set the keyword search from the phrases, each with its own detection threshold.
+    * Reactivate the keyword search afterwards if it was the active one.
+    * @return false if the list is empty or a phrase has words missing in the dictionary
+    */
+   bool setKeyPhrases( const api::asr::KeyPhraseList& phrases );
    bool addWordToDict( const api::asr::GraphemePhoneme& wordAndTranscript, bool updateDict = false );
+
+   /**
+    * Add words missing in the dictionary without rebuilding the searches.
+    * A known word with another pronunciation gets it as an alternative, "word(2)" and so on.
+    * Set or update a search afterwards to make the words recognizable.
+    * @return number of pronunciations added, the known ones are skipped
+    */
+   size_t addWordsToDict( const api::asr::GraphemePhonemeList& g2pList );
+
+   /**
+    * Check whether the word is in the dictionary.
+    */
+   bool hasWord( const std::string& word );
    bool setGrammarFile( const std::string& grammarFile );
    bool setGrammar( const std::string& grammarCode );
+
+   /**
+    * Set the pruning profile of the search and recreate the search if it is set already.
+    * The profile limits the beams and the number of HMMs evaluated per frame: when there are
+    * more active HMMs the search narrows its beams until they fit, so the cost per frame
+    * stays bounded however many words the grammar has. Both searches start with "command".
+    * Must be called from the thread feeding the decoder, between two audio chunks.
+    * @param profile - one of getProfileNames()
+    * @return false if the profile is unknown or the search is active and speech is in progress
+    */
+   bool setProfile( api::asr::RecognizerMode::eRecognizerMode mode, const std::string& profile );
+
+   /**
+    * Get the pruning profile of the search.
+    */
+   std::string getProfile( api::asr::RecognizerMode::eRecognizerMode mode ) const;
+
+   /**
+    * Get the names of the pruning profiles from the cheapest to the most accurate one.
+    */
+   static std::vector<std::string> getProfileNames( void );
+
+   /**
+    * Set the grammar search from the compiled FSG file.
+    */
+   bool setGrammarFsgFile( const std::string& fsgFile );
+
+   /**
+    * Compile the JSGF grammar, set it as the grammar search and store the result to the FSG file.
+    * @return true if the grammar is set, storing is best effort
+    */
+   bool compileGrammarFile( const std::string& grammarFile, const std::string& fsgFile );
+
+   /**
+    * The same as compileGrammarFile() for the grammar code.
+    */
+   bool compileGrammar( const std::string& grammarCode, const std::string& fsgFile );
    bool activateMode( api::asr::RecognizerMode::eRecognizerMode mode );
+
+   /**
+    * Get the mode of the active search, NONE if it is not one of ours.
+    */
+   api::asr::RecognizerMode::eRecognizerMode getActiveMode( void );
+
+   /**
+    * Switch the search while the decoder is fed with the audio.
+    * Must be called from the thread feeding the decoder, between two audio chunks.
+    * The current utterance is ended and started again with the new search,
+    * so it fails while speech is in progress.
+    * @return true if the new search is active
+    */
+   bool switchModeLive( api::asr::RecognizerMode::eRecognizerMode mode );
+
+   /**
+    * Checks whether the decoder VAD detects speech in the current utterance.
+    */
+   bool isInSpeech( void );
+   bool startUtterance( void );
    bool endUtterance( void );
 
+   /**
+    * Get the number of utterances started through this wrapper, also by setProfile() and switchModeLive().
+    * The owner of the stream may start its own ones with ps_start_utt(), they are not counted.
+    */
+   size_t getUtteranceStarts( void ) const;
+
+   /**
+    * Feed 16 bit PCM samples to the active search.
+    * @param fullUtterance - true if the samples are the whole utterance
+    */
+   bool processRaw( const short* samples, size_t count, bool fullUtterance = false );
+
+   /**
+    * Get the current best hypothesis.
+    * @return hypothesis text or empty string if there is none
+    */
+   std::string getHypothesis( void );
+
+   /**
+    * Get the posterior probability [0..1] of the current best hypothesis.
+    */
+   double getConfidence( void );
+
+   /**
+    * Get the log posterior probability of the current best hypothesis,
+    * the same value the pocketsphinx element reports as confidence.
+    */
+   long getRawConfidence( void );
+
+   /**
+    * Get the last frame of the last word of the current hypothesis.
+    * @return frame index from the utterance start or -1 if there are no words
+    */
+   int getHypothesisEndFrame( void );
+
+   /**
+    * Get the best hypotheses of the finished utterance.
+    * The lattice is built on this call, so call it only if the alternatives are needed.
+    * @param count - maximum number of alternatives, 0 returns an empty pointer
+    * @return alternatives stored in a new utterance arena or empty pointer if there is no hypothesis
+    */
+   api::asr::NBestListPtr getNBest( size_t count );
+
+   /**
+    * Get the number of frames processed in the current utterance.
+    */
+   int getFrameCount( void );
+
+   /**
+    * Get the number of frames per second.
+    */
+   int getFrameRate( void );
+
+   /**
+    * Get the duration of the audio decoded in the last utterance in seconds.
+    * The CPU time pocketsphinx measures is the one of the whole process,
+    * so it is not reported, the callers measure their own thread.
+    */
+   double getUtteranceDuration( void );
+
+private:
+   float32 getLanguageWeight( void );
+
+   /**
+    * Start both searches with the default pruning profile.
+    */
+   void initProfiles( void );
+
+   /**
+    * Put the pruning settings of the search profile to the config, the search reads them on creation.
+    */
+   void configureSearch( api::asr::RecognizerMode::eRecognizerMode mode );
+
+   /**
+    * Recreate the search from the source it was set from.
+    */
+   bool rebuildSearch( api::asr::RecognizerMode::eRecognizerMode mode );
+   bool setKeyList( const std::string& listFile );
+
+   /**
+    * Phones of the word separated by single spaces, empty if the word is unknown.
+    */
+   std::string getPronunciation( const std::string& word );
+   static std::vector<std::string> splitPhones( const std::string& phones );
+
+   /**
+    * Build the grammar search from the parsed grammar and store it to the FSG file, the grammar is freed.
+    */
+   bool compileJsgf( jsgf_t* jsgf, const std::string& fsgFile );
+
 private:
    ps_decoder_t* mDecoder;
-};
\ No newline at end of file
+   std::map<int, std::string> mProfiles;   ///< Pruning profile per search
+   std::string mKeyFile;                   ///< Source of the keyword search unless it is set from the phrases
+   api::asr::KeyPhraseList mKeyPhrases;
+   size_t mUtteranceStarts;
+};
@@ -0,0 +1,160 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CGrammarBuilder.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   JSGF grammar with replaceable word lists
+ ************************************************************************/
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <cctype>
+#include <boost/algorithm/string.hpp>
+#include <boost/regex.hpp>
+
+#include "CGrammarBuilder.hpp"
+
+static const char* RULE_PATTERN = "(<%1%>\\s*=)[^;]*;";
+static const char* VOID_RULE = "<VOID>";
+static const char* ALTERNATIVE_SEPARATOR = " | ";
+
+namespace
+{
+/**
+ * A node of the word prefix tree, the children are indexes in the node list
+ */
+struct WordNode
+{
+   bool isEnd;
+   std::map<std::string, size_t> next;
+
+   WordNode( void ) : isEnd( false ) {}
+};
+
+typedef std::vector<WordNode> WordTree;
+
+void addPhrase( WordTree& tree, const std::string& phrase )
+{
+   std::vector<std::string> words;
+   boost::split( words, phrase, boost::is_any_of( " \t" ), boost::token_compress_on );
+   size_t node = 0;
+   for ( size_t i = 0; i < words.size(); ++i )
+   {
+      if ( words[ i ].empty() )
+      {
+         continue;
+      }
+      std::map<std::string, size_t>::const_iterator it = tree[ node ].next.find( words[ i ] );
+      if ( it == tree[ node ].next.end() )
+      {
+         tree.push_back( WordNode() );
+         it = tree[ node ].next.insert( std::make_pair( words[ i ], tree.size() - 1 ) ).first;
+      }
+      node = it->second;
+   }
+   if ( node != 0 )
+   {
+      tree[ node ].isEnd = true;
+   }
+}
+
+std::string renderAlternatives( const WordTree& tree, size_t node )
+{
+   std::string result;
+   const std::map<std::string, size_t>& next = tree[ node ].next;
+   for ( std::map<std::string, size_t>::const_iterator it = next.begin(); it != next.end(); ++it )
+   {
+      result += ( it == next.begin() ) ? "" : ALTERNATIVE_SEPARATOR;
+      result += it->first;
+      const WordNode& child = tree[ it->second ];
+      if ( child.next.empty() )
+      {
+         continue;
+      }
+      std::string tail = renderAlternatives( tree, it->second );
+      if ( child.isEnd )
+      {
+         result += " [ " + tail + " ]";
+      }
+      else if ( child.next.size() == 1 )
+      {
+         result += " " + tail;
+      }
+      else
+      {
+         result += " ( " + tail + " )";
+      }
+   }
+   return result;
+}
+}
+
+CGrammarBuilder::CGrammarBuilder( const std::string& grammarCode )
+   : mGrammar( grammarCode )
+{
+}
+
+bool CGrammarBuilder::fromFile( const std::string& grammarFile, CGrammarBuilder& builder )
+{
+   std::ifstream stream( grammarFile.c_str(), std::ios::binary );
+   if ( !stream )
+   {
+      return false;
+   }
+   std::ostringstream content;
+   content << stream.rdbuf();
+   builder.mGrammar = content.str();
+   return true;
+}
+
+bool CGrammarBuilder::setRule( const std::string& ruleName, const std::vector<std::string>& words )
+{
+   // rule names are plain identifiers, escape them anyway to keep the pattern sane
+   std::string escapedName = boost::regex_replace( ruleName, boost::regex( "[.^$|()\\[\\]{}*+?\\\\]" ), "\\\\$&" );
+   std::string pattern( RULE_PATTERN );
+   pattern.replace( pattern.find( "%1%" ), 3, escapedName );
+   boost::smatch match;
+   if ( !boost::regex_search( mGrammar, match, boost::regex( pattern ) ) )
+   {
+      return false;
+   }
+
+   // phrases are grouped by their leading words, the grammar gets shorter
+   // but the search is the same: its lexicon tree already shares phone prefixes
+   WordTree tree( 1 );
+   for ( size_t i = 0; i < words.size(); ++i )
+   {
+      if ( isValidPhrase( words[ i ] ) )
+      {
+         addPhrase( tree, words[ i ] );
+      }
+   }
+   std::string body = renderAlternatives( tree, 0 );
+   if ( body.empty() )
+   {
+      body = VOID_RULE;
+   }
+   mGrammar.replace( match.position(), match.length(), match.str( 1 ) + " " + body + " ;" );
+   return true;
+}
+
+bool CGrammarBuilder::isValidPhrase( const std::string& phrase )
+{
+   for ( size_t i = 0; i < phrase.size(); ++i )
+   {
+      unsigned char symbol = static_cast<unsigned char>( phrase[ i ] );
+      // bytes of multibyte UTF-8 characters are never JSGF syntax
+      bool isWordSymbol = ( symbol >= 0x80 ) || std::isalnum( symbol ) || symbol == '_' || symbol == '\'';
+      if ( !isWordSymbol && symbol != ' ' && symbol != '\t' )
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+std::string CGrammarBuilder::getGrammar( void ) const
+{
+   return mGrammar;
+}
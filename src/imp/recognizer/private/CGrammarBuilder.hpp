@@ -0,0 +1,58 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CGrammarBuilder.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   JSGF grammar with replaceable word lists
+ ************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Takes the language JSGF grammar and replaces bodies of its rules
+ * with lists of alternative words, for example:
+ * setRule( "project_name", { "GROOT", "JENKINS" } ) turns
+ * "<project_name> = GROOT ;" into "<project_name> = GROOT | JENKINS ;"
+ * Common leading words of the phrases are written once:
+ * { "BUILD CORE", "BUILD UI", "DEPLOY" } gives "BUILD ( CORE | UI ) | DEPLOY".
+ */
+class CGrammarBuilder
+{
+public:
+   /**
+    * @param grammarCode - the source JSGF grammar
+    */
+   explicit CGrammarBuilder( const std::string& grammarCode );
+
+   /**
+    * Read the source grammar from the file.
+    * @return false if the file can't be read
+    */
+   static bool fromFile( const std::string& grammarFile, CGrammarBuilder& builder );
+
+   /**
+    * Replace the body of the rule with the alternatives.
+    * Duplicates are dropped, the alternatives come out sorted.
+    * Phrases which are not valid per isValidPhrase() are skipped.
+    * An empty list makes the rule <VOID>, so it never matches.
+    * @return false if the grammar has no such rule
+    */
+   bool setRule( const std::string& ruleName, const std::vector<std::string>& words );
+
+   /**
+    * Check whether every word of the phrase is a plain JSGF token:
+    * letters, digits, '_' and apostrophes. Other characters like "-.|;(<" are JSGF syntax or break the parser.
+    */
+   static bool isValidPhrase( const std::string& phrase );
+
+   /**
+    * Get the resulting grammar code.
+    */
+   std::string getGrammar( void ) const;
+
+private:
+   std::string mGrammar;
+};
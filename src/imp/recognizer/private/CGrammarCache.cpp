@@ -0,0 +1,168 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CGrammarCache.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   On-disk cache of compiled grammars
+ ************************************************************************/
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include "CGrammarCache.hpp"
+#include "CDecoder.hpp"
+#include "imp/logger/CLogger.hpp"
+
+namespace fs = boost::filesystem;
+
+/**
+ * CRC-64/ECMA-182
+ */
+typedef boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> Crc64;
+
+static const char* FSG_FILE_EXTENSION = ".fsg";
+static const char* TEMP_FILE_EXTENSION = ".tmp";
+static const char* CACHE_FILE_FORMAT = "%1%%2$016x%3%";
+static const char* FILE_PREFIX_FORMAT = "%1%-";
+static const char* CODE_PREFIX_FORMAT = "%1%-custom-";
+static const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+static void hashFileContent( Crc64& crc, const std::string& fileName )
+{
+   std::ifstream stream( fileName.c_str(), std::ios::binary );
+   std::vector<char> buffer( READ_CHUNK_SIZE );
+   while ( stream.read( &buffer[ 0 ], buffer.size() ) || stream.gcount() > 0 )
+   {
+      crc.process_bytes( &buffer[ 0 ], static_cast<size_t>( stream.gcount() ) );
+   }
+}
+
+static void hashString( Crc64& crc, const std::string& value )
+{
+   // the terminating zero separates the fields
+   crc.process_bytes( value.c_str(), value.size() + 1 );
+}
+
+/**
+ * The acoustic model may be large, so it is identified by the names, sizes and
+ * modification times of its files instead of the content.
+ */
+static void hashDirectoryStamp( Crc64& crc, const std::string& directory )
+{
+   boost::system::error_code error;
+   std::vector<fs::path> files;
+   for ( fs::directory_iterator it( directory, error ), end; !error && it != end; it.increment( error ) )
+   {
+      if ( fs::is_regular_file( it->status() ) )
+      {
+         files.push_back( it->path() );
+      }
+   }
+   std::sort( files.begin(), files.end() );
+   for ( size_t i = 0; i < files.size(); ++i )
+   {
+      hashString( crc, files[ i ].filename().string() );
+      hashString( crc, str( boost::format( "%1%:%2%" )
+         % fs::file_size( files[ i ], error ) % fs::last_write_time( files[ i ], error ) ) );
+   }
+}
+
+static std::string makeCacheFile( Crc64& crc, const CLanguageFiles& files, const std::string& prefix )
+{
+   hashFileContent( crc, files.getDictFile() );
+   hashDirectoryStamp( crc, files.getModelDir() );
+   std::string fileName = str( boost::format( CACHE_FILE_FORMAT ) % prefix % crc.checksum() % FSG_FILE_EXTENSION );
+   return ( fs::path( files.getCacheDir() ) / fileName ).string();
+}
+
+CGrammarCache::CGrammarCache( const CLanguageFiles& files )
+   : mFiles( files )
+   , mGrammarCode()
+   , mPrefix( str( boost::format( FILE_PREFIX_FORMAT ) % files.getLanguage() ) )
+   , mCacheFile()
+{
+   Crc64 crc;
+   hashFileContent( crc, mFiles.getGrammarFile() );
+   mCacheFile = makeCacheFile( crc, mFiles, mPrefix );
+}
+
+CGrammarCache::CGrammarCache( const CLanguageFiles& files, const std::string& grammarCode )
+   : mFiles( files )
+   , mGrammarCode( grammarCode )
+   , mPrefix( str( boost::format( CODE_PREFIX_FORMAT ) % files.getLanguage() ) )
+   , mCacheFile()
+{
+   Crc64 crc;
+   hashString( crc, mGrammarCode );
+   mCacheFile = makeCacheFile( crc, mFiles, mPrefix );
+}
+
+std::string CGrammarCache::getCacheFile( void ) const
+{
+   return mCacheFile;
+}
+
+bool CGrammarCache::apply( CDecoder& decoder ) const
+{
+   boost::system::error_code error;
+   if ( fs::exists( mCacheFile, error ) )
+   {
+      if ( decoder.setGrammarFsgFile( mCacheFile ) )
+      {
+         CLogger::debug() << "Compiled grammar is loaded from " << mCacheFile;
+         return true;
+      }
+      CLogger::warning() << "Compiled grammar is broken, recompiling: " << mCacheFile;
+   }
+
+   fs::create_directories( mFiles.getCacheDir(), error );
+   std::string tempFile = mCacheFile + TEMP_FILE_EXTENSION;
+   bool isCompiled = mGrammarCode.empty() ? decoder.compileGrammarFile( mFiles.getGrammarFile(), tempFile )
+      : decoder.compileGrammar( mGrammarCode, tempFile );
+   if ( !isCompiled )
+   {
+      fs::remove( tempFile, error );
+      if ( !mGrammarCode.empty() )
+      {
+         CLogger::warning() << "Unable to compile the grammar made from " << mFiles.getGrammarFile();
+         return decoder.setGrammar( mGrammarCode );
+      }
+      CLogger::warning() << "Unable to compile the grammar, using " << mFiles.getGrammarFile();
+      return decoder.setGrammarFile( mFiles.getGrammarFile() );
+   }
+   // rename is atomic, so a concurrent reader never sees a partially written file
+   fs::rename( tempFile, mCacheFile, error );
+   if ( error )
+   {
+      fs::remove( tempFile, error );
+      CLogger::warning() << "Unable to store the compiled grammar to " << mCacheFile;
+   }
+   else
+   {
+      removeStaleFiles();
+      CLogger::debug() << "Compiled grammar is stored to " << mCacheFile;
+   }
+   return true;
+}
+
+void CGrammarCache::removeStaleFiles( void ) const
+{
+   boost::system::error_code error;
+   std::string current = fs::path( mCacheFile ).filename().string();
+   for ( fs::directory_iterator it( mFiles.getCacheDir(), error ), end; !error && it != end; it.increment( error ) )
+   {
+      std::string name = it->path().filename().string();
+      // the hash has a fixed length, so files of the other grammar kind never match
+      if ( name != current && name.size() == current.size() && boost::starts_with( name, mPrefix )
+         && boost::ends_with( name, FSG_FILE_EXTENSION ) )
+      {
+         boost::system::error_code removeError;
+         fs::remove( it->path(), removeError );
+      }
+   }
+}
@@ -0,0 +1,55 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CGrammarCache.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   On-disk cache of compiled grammars
+ ************************************************************************/
+#pragma once
+
+#include <string>
+
+#include "CLanguageFiles.hpp"
+
+class CDecoder;
+
+/**
+ * Keeps the grammar compiled to the FSG format, so the JSGF grammar
+ * is expanded only when it changes.
+ * The cache file name contains a hash of the grammar, the dictionary and the acoustic model,
+ * a stale file never matches and is replaced by the freshly compiled one.
+ * A grammar built at runtime (job names, key phrases) has its own cache file next to
+ * the one of the language grammar, so switching between them does not compile anything.
+ */
+class CGrammarCache
+{
+public:
+   explicit CGrammarCache( const CLanguageFiles& files );
+
+   /**
+    * @param grammarCode - JSGF grammar made from the language grammar, it is hashed instead of the grammar file
+    */
+   CGrammarCache( const CLanguageFiles& files, const std::string& grammarCode );
+
+   /**
+    * Get the cache file matching the current language pack files.
+    */
+   std::string getCacheFile( void ) const;
+
+   /**
+    * Set the grammar search of the decoder from the cache.
+    * Compiles and stores the grammar if the cache is missing or stale,
+    * falls back to the JSGF file if the cache can't be used.
+    */
+   bool apply( CDecoder& decoder ) const;
+
+private:
+   void removeStaleFiles( void ) const;
+
+private:
+   CLanguageFiles mFiles;
+   std::string mGrammarCode;   ///< Empty for the grammar file
+   std::string mPrefix;        ///< Cache files of the same grammar kind start with it
+   std::string mCacheFile;
+};
@@ -6,6 +6,7 @@
  * @author  Hlieb Romanov
  * @brief   Pipeline with pocketsphinx decoder
  ************************************************************************/
+#include <algorithm>
 #include <boost/thread.hpp>
 #include <boost/format.hpp>
 
@@ -19,18 +20,50 @@
 GST_DEBUG_CATEGORY_STATIC( recognizer_debug );
 
 static const guint64 MAX_WAIT_TIMEOUT = 5 * GST_SECOND;
+static const unsigned int DECODER_SAMPLE_RATE = 16000;
+static const unsigned int HISTORY_SECONDS = 5;
+// how long the utterance waits for the slower decoders after the first one has finalized it
+static const boost::chrono::milliseconds FINAL_DEADLINE( 500 );
+static const unsigned int REPLAY_CHUNK_SAMPLES = DECODER_SAMPLE_RATE / 10;
+// a decoder frame of silence
+static const unsigned int ENDPOINT_FLUSH_SAMPLES = DECODER_SAMPLE_RATE / 100;
 
-static const char* PIPELINE_SPEC = "directsoundsrc name=asrc ! audioconvert ! audioresample ! pocketsphinx name=asr ! fakesink";
-static const char* ASR_NAME = "asr";
+static const char* CAPTURE_SOURCE = "directsoundsrc";
+static const char* CAPTURE_SPEC = "directsoundsrc name=asrc%1% ! %2% ! tee name=t";
+// the format the decoders take, the capture is pinned to it
+static const char* DECODER_CAPS = "audio/x-raw,format=S16LE,channels=1,rate=16000";
+static const char* DECODER_FORMAT_CAPS = "audio/x-raw,format=S16LE,channels=1";
+static const char* DECODER_RATE_CAPS = "audio/x-raw,rate=16000";
+static const char* CONVERT_SPEC = " ! audioconvert";
+static const char* RESAMPLE_SPEC = " ! audioresample";
+static const char* DECODER_SPEC = " t. ! pocketsphinx name=asr%1% ! fakesink";
+// a queue per decoder gives it a streaming thread, 2 seconds of slack before the capture blocks
+static const char* PARALLEL_DECODER_SPEC = " t. ! queue max-size-buffers=0 max-size-bytes=0 max-size-time=2000000000 ! pocketsphinx name=asr%1% ! fakesink";
+static const char* ASR_NAME = "asr%1%";
+static const char* TEE_NAME = "t";
 static const char* AUDIO_SOURCE = "asrc";
 static const char* ASR_HMM_PARAM = "hmm";
 static const char* ASR_DICT_PARAM = "dict";
 static const char* ASR_DECODER_PARAM = "decoder";
+static const char* ASR_MESSAGE_NAME = "pocketsphinx";
+static const char* ASR_FINAL_FIELD = "final";
+static const char* ASR_HYPOTHESIS_FIELD = "hypothesis";
+static const char* ASR_CONFIDENCE_FIELD = "confidence";
 
 static const char* PIPELINE_ERROR_MSG = "Can't create the recognizer pipeline, GStreamer returns NULL";
 static const char* POCKETSPHINX_ERROR_MSG = "Can't create the pocketsphinx element, GStreamer returns NULL";
+static const char* MODELS_ERROR_MSG = "The recognizer pipeline needs at least one decoder model";
 static const char* RECOGNIZER_ERROR_MSG = "Recognizer may be in inconsistent state. Aborting.";
 static const char* PARSE_ERROR_MSG = "GStreamer error (%1%): %2%";
+static const char* MODE_SWITCH_ERROR_MSG = "Can't switch the recognizer mode to %1%";
+static const char* PROFILE_ERROR_MSG = "Can't set the %1% profile of the recognizer mode %2%";
+static const char* VOICE_GATE_MSG = "Voice activity gate skipped %1% of %2% frames";
+static const char* CAPTURE_CAPS_MSG = "Capture source offers %1%, conversions:%2%";
+static const char* CAPTURE_NEGOTIATED_MSG = "Capture negotiated %1% at the source and %2% at the decoders";
+static const char* ENDPOINT_MSG = "Endpointer ended the %1% utterance after %2% ms of silence (hangover %3% ms): '%4%'";
+static const char* DECODER_ENDPOINT_MSG = "Decoder ended the %1% utterance itself after %2% ms of silence";
+static const char* UTTERANCE_WINNER_MSG = "Utterance is recognized as %1% '%2%', posterior %3% of %4% decoders";
+static const char* LATE_FINAL_MSG = "Decoder %1% finalized the utterance after the deadline, '%2%' is dropped";
 
 static void finalizeMainLoop( GMainLoop* loop )
 {
@@ -48,28 +81,86 @@ static void THROW_FATAL( const std::string&  message )
    throw std::runtime_error( message );
 }
 
-CGstRecognizerPipeline::CGstRecognizerPipeline( const std::string& hmmDir, const std::string& dictFile )
+/**
+ * The endpointer needs the silence right as it is, the hangover is its own
+ */
+static CVoiceActivityGate::Params makeSilenceParams( void )
+{
+   CVoiceActivityGate::Params result;
+   result.sampleRate = DECODER_SAMPLE_RATE;
+   result.hangoverMs = 0;
+   return result;
+}
+
+static unsigned int samplesToMs( size_t samples )
+{
+   return static_cast<unsigned int>( samples * 1000 / DECODER_SAMPLE_RATE );
+}
+
+CGstRecognizerPipeline::DecoderBranch::DecoderBranch( const std::string& _language, const CGstElement& _element )
+   : language( _language )
+   , element( _element )
+   , decoder()
+   , history( HISTORY_SECONDS * DECODER_SAMPLE_RATE )
+   , utteranceStart( 0 )
+   , utteranceCpu( boost::chrono::thread_clock::duration::zero() )
+   , keywordEnd( 0 )
+   , hasKeywordEnd( false )
+   , hasPendingMode( false )
+   , isInjecting( false )
+   , silenceDetector( makeSilenceParams() )
+   , trailingSilence( 0 )
+   , isEndpointed( false )
+{
+
+}
+
+CGstRecognizerPipeline::CGstRecognizerPipeline( const std::vector<DecoderModel>& models )
    : mListening( false )
    , mIsEosReceived( false )
-   , mPipeline( PIPELINE_SPEC )
-   , mPocketSphinx( mPipeline.getElementByName( ASR_NAME ) )
+   , mPipeline( makePipelineSpec( models.size() ) )
+   , mTee( mPipeline.getElementByName( TEE_NAME ) )
    , mLoop( NULL ) 
+   , mNBestSize( 0 )
+   , mPartialLanguage( models.empty() ? std::string() : models.front().language )
+   , mPrerollSamples( 0 )
+   , mReplayingPreroll( false )
+   , mCapsAudited( false )
+   , mDeadlineSource( 0 )
+   , mPendingMode( api::asr::RecognizerMode::NONE )
 {
    GST_DEBUG_CATEGORY_INIT( recognizer_debug, "CGstRecognizerPipeline", 0, "CGstRecognizerPipeline" );
    GST_CAT_DEBUG( recognizer_debug, "Constructor" );
-   if ( !mPipeline.isValid() )
+   if ( models.empty() )
+   {
+      THROW_FATAL( MODELS_ERROR_MSG );
+   }
+   if ( !mPipeline.isValid() || !mTee.isValid() )
    {
       THROW_FATAL( PIPELINE_ERROR_MSG );
    }
-   if ( !mPocketSphinx.isValid() )
+   for ( size_t i = 0; i < models.size(); ++i )
    {
-      THROW_FATAL( POCKETSPHINX_ERROR_MSG );
+      DecoderBranchPtr branch( new DecoderBranch( models[ i ].language,
+         mPipeline.getElementByName( str( boost::format( ASR_NAME ) % i ) ) ) );
+      if ( !branch->element.isValid() )
+      {
+         THROW_FATAL( POCKETSPHINX_ERROR_MSG );
+      }
+      GST_CAT_DEBUG( recognizer_debug, "Setting pocketsphinx HMM and dict files of %s...", models[ i ].language.c_str() );
+      branch->element.setProperty( ASR_HMM_PARAM, models[ i ].hmmDir );
+      branch->element.setProperty( ASR_DICT_PARAM, models[ i ].dictFile );
+      branch->element.getSinkPad().addProbe( GST_PAD_PROBE_TYPE_BUFFER,
+         boost::bind( &CGstRecognizerPipeline::onDecoderBuffer, self(), branch.get(), _1 ) );
+      branch->element.getSrcPad().addProbe( GST_PAD_PROBE_TYPE_BUFFER,
+         boost::bind( &CGstRecognizerPipeline::onDecodedBuffer, self(), branch.get(), _1 ) );
+      mBranches.push_back( branch );
    }
-   GST_CAT_DEBUG( recognizer_debug, "Setting pocketsphinx HMM and dict files..." );
-   mPocketSphinx.setProperty( ASR_HMM_PARAM, hmmDir );
-   mPocketSphinx.setProperty( ASR_DICT_PARAM, dictFile );
    GST_CAT_DEBUG( recognizer_debug, "Setting bus callback..." );
    mPipeline.setBusCallback( boost::bind( &CGstRecognizerPipeline::onBusCall, self(), _1, _2 ) );
+   mPipeline.setBusSyncCallback( boost::bind( &CGstRecognizerPipeline::onBusSync, self(), _1, _2 ) );
+   GST_CAT_DEBUG( recognizer_debug, "Setting voice activity probe..." );
+   mTee.getSinkPad().addProbe( GST_PAD_PROBE_TYPE_BUFFER, boost::bind( &CGstRecognizerPipeline::onAudioBuffer, self(), _1 ) );
    GST_CAT_DEBUG( recognizer_debug, "Creating main loop..." );
    mLoop.reset( g_main_loop_new( NULL, FALSE ), finalizeMainLoop );
    boost::thread mainLoopRunner = boost::thread( [this]() {
@@ -90,10 +181,96 @@ CGstRecognizerPipeline::CGstRecognizerPipeline( const std::string& hmmDir, const
 CGstRecognizerPipeline::~CGstRecognizerPipeline( void )
 {
    GST_CAT_DEBUG( recognizer_debug, "Destructor" );
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      cancelFinalDeadline();
+   }
    if ( isInitialized() )
    {
       deinitialize();
    }
+   clearPreroll();
+}
+
+static std::string capsToString( GstCaps* caps )
+{
+   if ( caps == NULL )
+   {
+      return "nothing";
+   }
+   gchar* text = gst_caps_to_string( caps );
+   std::string result( text );
+   g_free( text );
+   return result;
+}
+
+static bool canIntersect( GstCaps* caps, const char* spec )
+{
+   GstCaps* other = gst_caps_from_string( spec );
+   bool result = ( gst_caps_can_intersect( caps, other ) != FALSE );
+   gst_caps_unref( other );
+   return result;
+}
+
+/**
+ * Ask the opened capture device what it can deliver, convert only what it can't.
+ */
+static std::string queryCaptureConversions( void )
+{
+   std::string conversions = std::string( CONVERT_SPEC ) + RESAMPLE_SPEC;
+   std::string offered;
+   CGstElement source( CAPTURE_SOURCE );
+   if ( source.isValid() && source.getSrcPad().isValid() && source.setState( GST_STATE_READY ) )
+   {
+      GstCaps* caps = gst_pad_query_caps( source.getSrcPad().raw(), NULL );
+      offered = capsToString( caps );
+      if ( caps != NULL && canIntersect( caps, DECODER_CAPS ) )
+      {
+         conversions.clear();
+      }
+      else if ( caps != NULL && canIntersect( caps, DECODER_FORMAT_CAPS ) )
+      {
+         conversions = RESAMPLE_SPEC;
+      }
+      else if ( caps != NULL && canIntersect( caps, DECODER_RATE_CAPS ) )
+      {
+         conversions = CONVERT_SPEC;
+      }
+      if ( caps != NULL )
+      {
+         gst_caps_unref( caps );
+      }
+      source.setState( GST_STATE_NULL );
+   }
+   CLogger::info() << str( boost::format( CAPTURE_CAPS_MSG ) % ( offered.empty() ? std::string( "unknown caps" ) : offered )
+      % ( conversions.empty() ? std::string( " none" ) : conversions ) );
+   return conversions;
+}
+
+std::string CGstRecognizerPipeline::makeCaptureSpec( void )
+{
+   // the device is opened once, the pipelines pre-built for the other languages reuse its answer
+   static boost::mutex guard;
+   static bool isQueried = false;
+   static std::string conversions;
+   boost::lock_guard<boost::mutex> lock( guard );
+   if ( !isQueried )
+   {
+      conversions = queryCaptureConversions();
+      isQueried = true;
+   }
+   return str( boost::format( CAPTURE_SPEC ) % conversions % DECODER_CAPS );
+}
+
+std::string CGstRecognizerPipeline::makePipelineSpec( size_t decoders )
+{
+   // a single decoder stays in the capture thread like it always did
+   std::string result( makeCaptureSpec() );
+   for ( size_t i = 0; i < decoders; ++i )
+   {
+      result += str( boost::format( ( decoders > 1 ) ? PARALLEL_DECODER_SPEC : DECODER_SPEC ) % i );
+   }
+   return result;
 }
 
 CGstRecognizerPipeline* CGstRecognizerPipeline::self( void )
@@ -121,6 +298,7 @@ bool CGstRecognizerPipeline::startListening( void )
       result = mPipeline.setState( GST_STATE_PLAYING, true );
       GST_CAT_DEBUG( recognizer_debug, "Set state result: %d", result );
       mListening = result;
+      mCapsAudited = false;
       boost::lock_guard<boost::mutex> lock( mEosGuard );
       mIsEosReceived = false;
    }
@@ -148,12 +326,137 @@ void CGstRecognizerPipeline::stopListening( void )
       GST_CAT_DEBUG( recognizer_debug, "Setting state to GST_STATE_READY ASYNC..." );
       mListening = !mPipeline.setState( GST_STATE_READY );
       GST_CAT_DEBUG( recognizer_debug, "Set state result: %d", !mListening );
+      clearPreroll();
+      // a decoder which has not finalized the last utterance is not going to do it
+      flushFinals();
+      for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+      {
+         applyPendingMode( **it, false );
+         applyPendingProfiles( **it, false );
+      }
+      {
+         boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+         mPendingFinals.clear();
+         mDroppedFinals.clear();
+         mLateLanguages.clear();
+         for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+         {
+            ( *it )->isEndpointed = false;
+         }
+      }
+      {
+         // the next capture is not continuous with this one
+         boost::lock_guard<boost::mutex> lock( mModeGuard );
+         for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+         {
+            ( *it )->hasKeywordEnd = false;
+            ( *it )->keywordHypothesis.clear();
+            ( *it )->silenceDetector.reset();
+            ( *it )->trailingSilence = 0;
+         }
+      }
+      CVoiceActivityGate::Statistics statistics = getVoiceActivityStatistics();
+      CLogger::debug() << boost::format( VOICE_GATE_MSG ) % statistics.skippedFrames % statistics.totalFrames;
    }
 }
 
 DecoderPtr CGstRecognizerPipeline::getDecoder( void )
 {
-   return mDecoder;
+   return mBranches.front()->decoder;
+}
+
+DecoderPtr CGstRecognizerPipeline::getDecoder( const std::string& language )
+{
+   for ( DecoderBranchList::const_iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+   {
+      if ( ( *it )->language == language )
+      {
+         return ( *it )->decoder;
+      }
+   }
+   return DecoderPtr();
+}
+
+std::vector<std::string> CGstRecognizerPipeline::getLanguages( void ) const
+{
+   std::vector<std::string> result;
+   for ( DecoderBranchList::const_iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+   {
+      result.push_back( ( *it )->language );
+   }
+   return result;
+}
+
+bool CGstRecognizerPipeline::activateMode( api::asr::RecognizerMode::eRecognizerMode mode )
+{
+   bool result = !isListening();
+   for ( DecoderBranchList::iterator it = mBranches.begin(); result && it != mBranches.end(); ++it )
+   {
+      result = ( *it )->decoder && ( *it )->decoder->activateMode( mode );
+   }
+   return result;
+}
+
+void CGstRecognizerPipeline::setHypothesisCallback( const HypothesisCallback& callback )
+{
+   boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+   mHypothesisCallback = callback;
+}
+
+void CGstRecognizerPipeline::requestMode( api::asr::RecognizerMode::eRecognizerMode mode )
+{
+   {
+      boost::lock_guard<boost::mutex> lock( mModeGuard );
+      mPendingMode = mode;
+      for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+      {
+         ( *it )->hasPendingMode = true;
+      }
+   }
+   if ( !isListening() )
+   {
+      for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+      {
+         applyPendingMode( **it, false );
+      }
+   }
+}
+
+void CGstRecognizerPipeline::requestProfile( api::asr::RecognizerMode::eRecognizerMode mode, const std::string& profile )
+{
+   {
+      boost::lock_guard<boost::mutex> lock( mModeGuard );
+      for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+      {
+         ( *it )->pendingProfiles[ mode ] = profile;
+      }
+   }
+   if ( !isListening() )
+   {
+      for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+      {
+         applyPendingProfiles( **it, false );
+      }
+   }
+}
+
+void CGstRecognizerPipeline::setEndpointHangover( api::asr::RecognizerMode::eRecognizerMode mode, unsigned int milliseconds )
+{
+   boost::lock_guard<boost::mutex> lock( mModeGuard );
+   mEndpointHangovers[ mode ] = milliseconds;
+}
+
+void CGstRecognizerPipeline::setVoiceActivityParams( const CVoiceActivityGate::Params& params )
+{
+   clearPreroll();
+   boost::lock_guard<boost::mutex> lock( mVoiceGateGuard );
+   mVoiceGate.setParams( params );
+}
+
+CVoiceActivityGate::Statistics CGstRecognizerPipeline::getVoiceActivityStatistics( void )
+{
+   boost::lock_guard<boost::mutex> lock( mVoiceGateGuard );
+   return mVoiceGate.getStatistics();
 }
 
 bool CGstRecognizerPipeline::initialize( void )
@@ -169,10 +472,13 @@ bool CGstRecognizerPipeline::initialize( void )
    GST_CAT_DEBUG( recognizer_debug, "isInitialized: %d", result );
    if ( result )
    {
-      GST_CAT_DEBUG( recognizer_debug, "Getting ps_decoder object..." );
-      ps_decoder_t* decoder = mPocketSphinx.getProperty<ps_decoder_t*>( ASR_DECODER_PARAM );
-      mDecoder.reset( new CDecoder( decoder ) );
-      GST_CAT_DEBUG( recognizer_debug, "ps_decoder object is wrapped" );
+      GST_CAT_DEBUG( recognizer_debug, "Getting ps_decoder objects..." );
+      for ( DecoderBranchList::iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+      {
+         ps_decoder_t* decoder = ( *it )->element.getProperty<ps_decoder_t*>( ASR_DECODER_PARAM );
+         ( *it )->decoder.reset( new CDecoder( decoder ) );
+      }
+      GST_CAT_DEBUG( recognizer_debug, "ps_decoder objects are wrapped" );
    }
    return result;
 }
@@ -223,12 +529,605 @@ void CGstRecognizerPipeline::onBusCall( GstBus* bus, GstMessage* msg )
    default:
       break;
    }
-   const GstStructure *st = gst_message_get_structure(msg);
-   if (st && strcmp(gst_structure_get_name(st), "pocketsphinx") == 0) {
-	   if (g_value_get_boolean(gst_structure_get_value(st, "final")))
-    	   g_print("Got result %s, confidence: %ld\n", 
-            g_value_get_string(gst_structure_get_value(st, "hypothesis")),
-            g_value_get_long(gst_structure_get_value(st, "confidence"))
-         );
-    }
-}
\ No newline at end of file
+   const GstStructure* structure = gst_message_get_structure( msg );
+   if ( structure != NULL && strcmp( gst_structure_get_name( structure ), ASR_MESSAGE_NAME ) == 0 )
+   {
+      bool isFinal = g_value_get_boolean( gst_structure_get_value( structure, ASR_FINAL_FIELD ) );
+      const gchar* hypothesis = g_value_get_string( gst_structure_get_value( structure, ASR_HYPOTHESIS_FIELD ) );
+      long confidence = g_value_get_long( gst_structure_get_value( structure, ASR_CONFIDENCE_FIELD ) );
+      GST_CAT_DEBUG( recognizer_debug, "Got %s result '%s', confidence: %ld", isFinal ? "final" : "partial",
+         hypothesis != NULL ? hypothesis : "", confidence );
+      DecoderBranchPtr branch = findBranch( GST_MESSAGE_SRC( msg ) );
+      HypothesisData result;
+      if ( isFinal )
+      {
+         boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+         std::deque<GstMessage*>::iterator dropped = std::find( mDroppedFinals.begin(), mDroppedFinals.end(), msg );
+         if ( dropped != mDroppedFinals.end() )
+         {
+            // the utterance is reported by the endpointer already
+            mDroppedFinals.erase( dropped );
+            return;
+         }
+         // the messages come in the posting order, older entries belong to flushed messages
+         while ( !mPendingFinals.empty() )
+         {
+            bool isOurs = ( mPendingFinals.front().first == msg );
+            result = isOurs ? mPendingFinals.front().second : HypothesisData();
+            mPendingFinals.pop_front();
+            if ( isOurs )
+            {
+               break;
+            }
+         }
+      }
+      result.text = ( hypothesis != NULL ) ? hypothesis : "";
+      result.language = branch ? branch->language : std::string();
+      result.isFinal = isFinal;
+      result.confidence = confidence;
+      if ( isFinal )
+      {
+         submitFinal( result );
+      }
+      else
+      {
+         bool isReported = false;
+         {
+            boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+            isReported = ( result.language == mPartialLanguage );
+         }
+         if ( isReported )
+         {
+            notifyHypothesis( result );
+         }
+      }
+   }
+}
+
+void CGstRecognizerPipeline::onBusSync( GstBus* bus, GstMessage* msg )
+{
+   const GstStructure* structure = gst_message_get_structure( msg );
+   if ( structure == NULL || strcmp( gst_structure_get_name( structure ), ASR_MESSAGE_NAME ) != 0
+      || !g_value_get_boolean( gst_structure_get_value( structure, ASR_FINAL_FIELD ) ) )
+   {
+      return;
+   }
+   DecoderBranchPtr branch = findBranch( GST_MESSAGE_SRC( msg ) );
+   if ( !branch || !branch->decoder )
+   {
+      return;
+   }
+   // we are in the chain function of the element, the history has the samples it has just processed
+   // and the element starts the next utterance with the next buffer
+   branch->utteranceStart = branch->history.getPosition();
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      if ( branch->isEndpointed )
+      {
+         // the element finalizes the utterance the endpointer has started instead of its own
+         branch->isEndpointed = false;
+         mDroppedFinals.push_back( msg );
+         return;
+      }
+   }
+   CLogger::debug() << boost::format( DECODER_ENDPOINT_MSG ) % branch->language % samplesToMs( branch->trailingSilence );
+   // the element does not touch the decoder until the next buffer, the utterance is still there
+   HypothesisData result;
+   collectFinalData( *branch, result );
+   boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+   mPendingFinals.push_back( std::make_pair( msg, result ) );
+}
+
+void CGstRecognizerPipeline::collectFinalData( DecoderBranch& branch, HypothesisData& result )
+{
+   size_t count = 0;
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      count = mNBestSize;
+   }
+   const DecoderPtr& decoder = branch.decoder;
+   result.language = branch.language;
+   // the posterior is normalized by the decoder itself, unlike the path scores of different models
+   result.score = decoder->getConfidence();
+   result.alternatives = decoder->getNBest( count );
+   result.hasMetrics = true;
+   result.metrics.mode = decoder->getActiveMode();
+   result.metrics.audioDuration = decoder->getUtteranceDuration();
+   // the pocketsphinx timer counts the whole process, the other decoders and the capture included,
+   // the utterance is charged only what its streaming thread spent since it started
+   boost::chrono::thread_clock::time_point now = boost::chrono::thread_clock::now();
+   result.metrics.cpuTime = boost::chrono::duration<double>( branch.utteranceCpu + ( now - branch.chainStart ) ).count();
+   branch.utteranceCpu = boost::chrono::thread_clock::duration::zero();
+   branch.chainStart = now;
+   result.metrics.realTimeFactor = ( result.metrics.audioDuration > 0.0 ) ? result.metrics.cpuTime / result.metrics.audioDuration : 0.0;
+   result.metrics.frames = decoder->getFrameCount();
+   result.endOfSpeech = branch.lastAudioTime;
+}
+
+CGstRecognizerPipeline::DecoderBranchPtr CGstRecognizerPipeline::findBranch( GstObject* element ) const
+{
+   for ( DecoderBranchList::const_iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+   {
+      if ( GST_OBJECT( ( *it )->element.raw() ) == element )
+      {
+         return *it;
+      }
+   }
+   return DecoderBranchPtr();
+}
+
+void CGstRecognizerPipeline::submitFinal( const HypothesisData& hypothesis )
+{
+   std::vector<HypothesisData> previous;
+   std::vector<HypothesisData> current;
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      std::multiset<std::string>::iterator late = mLateLanguages.find( hypothesis.language );
+      if ( late != mLateLanguages.end() )
+      {
+         // the utterance is reported already
+         mLateLanguages.erase( late );
+         CLogger::debug() << boost::format( LATE_FINAL_MSG ) % hypothesis.language % hypothesis.text;
+         return;
+      }
+      for ( size_t i = 0; i < mUtteranceFinals.size(); ++i )
+      {
+         if ( mUtteranceFinals[ i ].language == hypothesis.language )
+         {
+            // the other decoders did not finalize the previous utterance
+            previous.swap( mUtteranceFinals );
+            break;
+         }
+      }
+      if ( !previous.empty() )
+      {
+         cancelFinalDeadline();
+      }
+      if ( mUtteranceFinals.empty() )
+      {
+         mFirstFinalTime = boost::chrono::steady_clock::now();
+      }
+      mUtteranceFinals.push_back( hypothesis );
+      if ( mUtteranceFinals.size() >= mBranches.size() )
+      {
+         current.swap( mUtteranceFinals );
+         cancelFinalDeadline();
+      }
+      else if ( mDeadlineSource == 0 )
+      {
+         // the decoder probes stop with the speech, the main loop flushes the finals if the rest never come
+         mDeadlineSource = g_timeout_add( static_cast<guint>( FINAL_DEADLINE.count() ), onFinalDeadline, this );
+      }
+   }
+   reportBest( previous );
+   reportBest( current );
+}
+
+void CGstRecognizerPipeline::flushLateFinals( void )
+{
+   std::vector<HypothesisData> finals;
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      if ( mUtteranceFinals.empty() || boost::chrono::steady_clock::now() - mFirstFinalTime < FINAL_DEADLINE )
+      {
+         return;
+      }
+      for ( DecoderBranchList::const_iterator it = mBranches.begin(); it != mBranches.end(); ++it )
+      {
+         bool isIn = false;
+         for ( size_t i = 0; i < mUtteranceFinals.size() && !isIn; ++i )
+         {
+            isIn = ( mUtteranceFinals[ i ].language == ( *it )->language );
+         }
+         if ( !isIn )
+         {
+            mLateLanguages.insert( ( *it )->language );
+         }
+      }
+      finals.swap( mUtteranceFinals );
+      cancelFinalDeadline();
+   }
+   reportBest( finals );
+}
+
+gboolean CGstRecognizerPipeline::onFinalDeadline( gpointer data )
+{
+   CGstRecognizerPipeline* pipeline = static_cast<CGstRecognizerPipeline*>( data );
+   {
+      boost::lock_guard<boost::mutex> lock( pipeline->mCallbackGuard );
+      if ( pipeline->mDeadlineSource != g_source_get_id( g_main_current_source() ) )
+      {
+         // the utterance was completed while this call waited for the lock
+         return G_SOURCE_REMOVE;
+      }
+      pipeline->mDeadlineSource = 0;
+   }
+   pipeline->flushLateFinals();
+   return G_SOURCE_REMOVE;
+}
+
+void CGstRecognizerPipeline::cancelFinalDeadline( void )
+{
+   if ( mDeadlineSource != 0 )
+   {
+      g_source_remove( mDeadlineSource );
+      mDeadlineSource = 0;
+   }
+}
+
+void CGstRecognizerPipeline::flushFinals( void )
+{
+   std::vector<HypothesisData> finals;
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      finals.swap( mUtteranceFinals );
+      cancelFinalDeadline();
+   }
+   reportBest( finals );
+}
+
+void CGstRecognizerPipeline::reportBest( const std::vector<HypothesisData>& finals )
+{
+   if ( finals.empty() )
+   {
+      return;
+   }
+   // an empty text never wins over a recognized one
+   size_t best = 0;
+   for ( size_t i = 1; i < finals.size(); ++i )
+   {
+      bool isBetter = finals[ best ].text.empty()
+         ? !finals[ i ].text.empty() || finals[ i ].score > finals[ best ].score
+         : !finals[ i ].text.empty() && finals[ i ].score > finals[ best ].score;
+      if ( isBetter )
+      {
+         best = i;
+      }
+   }
+   if ( mBranches.size() > 1 )
+   {
+      CLogger::debug() << boost::format( UTTERANCE_WINNER_MSG ) % finals[ best ].language % finals[ best ].text
+         % finals[ best ].score % finals.size();
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      mPartialLanguage = finals[ best ].language;
+   }
+   notifyHypothesis( finals[ best ] );
+}
+
+void CGstRecognizerPipeline::notifyHypothesis( const HypothesisData& hypothesis )
+{
+   HypothesisCallback callback;
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      callback = mHypothesisCallback;
+   }
+   if ( callback )
+   {
+      callback( hypothesis );
+   }
+}
+
+void CGstRecognizerPipeline::setNBestSize( size_t count )
+{
+   boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+   mNBestSize = count;
+}
+
+GstPadProbeReturn CGstRecognizerPipeline::onAudioBuffer( GstPadProbeInfo* info )
+{
+   GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER( info );
+   GstMapInfo map;
+   if ( buffer == NULL || !gst_buffer_map( buffer, &map, GST_MAP_READ ) )
+   {
+      return GST_PAD_PROBE_OK;
+   }
+   // the decoder sink caps are S16LE mono
+   const short* data = reinterpret_cast<const short*>( map.data );
+   size_t samples = map.size / sizeof( short );
+   if ( mReplayingPreroll )
+   {
+      // our own pre-roll coming back through the pad
+      gst_buffer_unmap( buffer, &map );
+      return GST_PAD_PROBE_OK;
+   }
+   if ( !mCapsAudited.exchange( true ) )
+   {
+      auditCaps();
+   }
+   std::deque<GstBuffer*> preroll;
+   {
+      boost::lock_guard<boost::mutex> lock( mVoiceGateGuard );
+      bool speech = mVoiceGate.process( data, samples );
+      gst_buffer_unmap( buffer, &map );
+      const CVoiceActivityGate::Params& params = mVoiceGate.getParams();
+      size_t maxPreroll = static_cast<size_t>( params.prerollMs ) * params.sampleRate / 1000;
+      if ( !speech )
+      {
+         mPreroll.push_back( gst_buffer_ref( buffer ) );
+         mPrerollSamples += samples;
+         while ( !mPreroll.empty() && mPrerollSamples - gst_buffer_get_size( mPreroll.front() ) / sizeof( short ) >= maxPreroll )
+         {
+            mPrerollSamples -= gst_buffer_get_size( mPreroll.front() ) / sizeof( short );
+            gst_buffer_unref( mPreroll.front() );
+            mPreroll.pop_front();
+         }
+         return GST_PAD_PROBE_DROP;
+      }
+      preroll.swap( mPreroll );
+      mPrerollSamples = 0;
+   }
+   if ( !preroll.empty() )
+   {
+      GST_CAT_DEBUG( recognizer_debug, "Speech onset, replaying %u pre-roll buffers", static_cast<unsigned int>( preroll.size() ) );
+      // we are in the streaming thread already, the stream lock is recursive
+      mReplayingPreroll = true;
+      for ( std::deque<GstBuffer*>::iterator it = preroll.begin(); it != preroll.end(); ++it )
+      {
+         gst_pad_chain( mTee.getSinkPad().raw(), *it );
+      }
+      mReplayingPreroll = false;
+   }
+   return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn CGstRecognizerPipeline::onDecoderBuffer( DecoderBranch* branch, GstPadProbeInfo* info )
+{
+   if ( branch->isInjecting )
+   {
+      // our own audio, injectAudio() has put it to the history
+      return GST_PAD_PROBE_OK;
+   }
+   GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER( info );
+   GstMapInfo map;
+   if ( buffer == NULL || !gst_buffer_map( buffer, &map, GST_MAP_READ ) )
+   {
+      return GST_PAD_PROBE_OK;
+   }
+   branch->lastAudioTime = boost::chrono::steady_clock::now();
+   branch->chainStart = boost::chrono::thread_clock::now();
+   flushLateFinals();
+   // the element is not inside its chain function, so it is an utterance boundary if there is no speech
+   trackKeyword( *branch );
+   HypothesisData endpointed;
+   if ( endpointUtterance( *branch, endpointed ) )
+   {
+      submitFinal( endpointed );
+   }
+   // this buffer goes to the next utterance if the current one is ended, the endpointer has flushed the element
+   const short* samples = reinterpret_cast<const short*>( map.data );
+   size_t count = map.size / sizeof( short );
+   branch->trailingSilence = branch->silenceDetector.process( samples, count ) ? 0 : branch->trailingSilence + count;
+   applyPendingMode( *branch, true );
+   applyPendingProfiles( *branch, true );
+   // the history follows the order the decoder sees the audio in, the pre-roll included
+   branch->history.write( samples, count );
+   gst_buffer_unmap( buffer, &map );
+   return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn CGstRecognizerPipeline::onDecodedBuffer( DecoderBranch* branch, GstPadProbeInfo* info )
+{
+   if ( !branch->isInjecting )
+   {
+      // the injected audio is counted by the probe of the buffer it was injected from
+      branch->utteranceCpu += boost::chrono::thread_clock::now() - branch->chainStart;
+   }
+   return GST_PAD_PROBE_OK;
+}
+
+bool CGstRecognizerPipeline::endpointUtterance( DecoderBranch& branch, HypothesisData& result )
+{
+   const DecoderPtr& decoder = branch.decoder;
+   if ( !decoder || !decoder->isInSpeech() )
+   {
+      return false;
+   }
+   unsigned int hangoverMs = 0;
+   {
+      boost::lock_guard<boost::mutex> lock( mModeGuard );
+      std::map<int, unsigned int>::const_iterator it = mEndpointHangovers.find( decoder->getActiveMode() );
+      hangoverMs = ( it != mEndpointHangovers.end() ) ? it->second : 0;
+   }
+   if ( hangoverMs == 0 || samplesToMs( branch.trailingSilence ) < hangoverMs )
+   {
+      return false;
+   }
+   // the decoder VAD would keep the utterance open longer, end it now and report it from here
+   decoder->endUtterance();
+   result.text = decoder->getHypothesis();
+   result.isFinal = true;
+   result.confidence = decoder->getRawConfidence();
+   collectFinalData( branch, result );
+   decoder->startUtterance();
+   branch.utteranceStart = branch.history.getPosition();
+   {
+      boost::lock_guard<boost::mutex> lock( mCallbackGuard );
+      branch.isEndpointed = true;
+   }
+   // The element has no action to end an utterance, this relies on gstpocketsphinx.c of pocketsphinx 5prealpha:
+   // gst_pocketsphinx_chain() calls ps_start_utt() only while its utt_started flag is FALSE, feeds the buffer
+   // to ps_process_raw(), sets listening_started when ps_get_in_speech() turns TRUE and calls
+   // gst_pocketsphinx_finalize_utt() as soon as ps_get_in_speech() is FALSE while listening_started is set.
+   // finalize_utt() returns unless both flags are set, otherwise it calls ps_end_utt(), posts the final
+   // message and clears both flags. Our ps_end_utt() and ps_start_utt() leave the flags set, so the element
+   // ends whatever it processes next: feed it a frame of silence, the restarted utterance is not in speech
+   // on it, the element ends that utterance and posts a final onBusSync() drops because of isEndpointed,
+   // and the buffer in hand starts a new utterance through utt_started instead of being lost.
+   // Revisit this when the element is updated.
+   std::vector<short> silence( ENDPOINT_FLUSH_SAMPLES, 0 );
+   injectAudio( branch, &silence[ 0 ], silence.size() );
+   CLogger::debug() << boost::format( ENDPOINT_MSG ) % branch.language % samplesToMs( branch.trailingSilence )
+      % hangoverMs % result.text;
+   return true;
+}
+
+void CGstRecognizerPipeline::auditCaps( void )
+{
+   CGstElement source( mPipeline.getElementByName( AUDIO_SOURCE ) );
+   GstCaps* sourceCaps = source.getSrcPad().isValid() ? gst_pad_get_current_caps( source.getSrcPad().raw() ) : NULL;
+   GstCaps* decoderCaps = gst_pad_get_current_caps( mTee.getSinkPad().raw() );
+   CLogger::info() << str( boost::format( CAPTURE_NEGOTIATED_MSG ) % capsToString( sourceCaps ) % capsToString( decoderCaps ) );
+   if ( sourceCaps != NULL )
+   {
+      gst_caps_unref( sourceCaps );
+   }
+   if ( decoderCaps != NULL )
+   {
+      gst_caps_unref( decoderCaps );
+   }
+}
+
+void CGstRecognizerPipeline::clearPreroll( void )
+{
+   boost::lock_guard<boost::mutex> lock( mVoiceGateGuard );
+   for ( std::deque<GstBuffer*>::iterator it = mPreroll.begin(); it != mPreroll.end(); ++it )
+   {
+      gst_buffer_unref( *it );
+   }
+   mPreroll.clear();
+   mPrerollSamples = 0;
+   mVoiceGate.reset();
+}
+
+void CGstRecognizerPipeline::applyPendingMode( DecoderBranch& branch, bool live )
+{
+   std::vector<short> command;
+   {
+      boost::lock_guard<boost::mutex> lock( mModeGuard );
+      const DecoderPtr& decoder = branch.decoder;
+      if ( !branch.hasPendingMode || !decoder )
+      {
+         return;
+      }
+      if ( live && decoder->isInSpeech() )
+      {
+         // wait for the end of the utterance
+         return;
+      }
+      api::asr::RecognizerMode::eRecognizerMode previousMode = decoder->getActiveMode();
+      size_t starts = decoder->getUtteranceStarts();
+      bool result = live ? decoder->switchModeLive( mPendingMode ) : decoder->activateMode( mPendingMode );
+      if ( decoder->getUtteranceStarts() != starts )
+      {
+         branch.utteranceStart = branch.history.getPosition();
+      }
+      if ( result )
+      {
+         GST_CAT_DEBUG( recognizer_debug, "Recognizer mode of %s is switched to %d", branch.language.c_str(),
+            static_cast<int>( mPendingMode ) );
+         if ( live && previousMode == api::asr::RecognizerMode::KEY_WORD_SEARCH
+            && mPendingMode == api::asr::RecognizerMode::GRAMMAR_SEARCH )
+         {
+            readCommand( branch, command );
+         }
+      }
+      else
+      {
+         CLogger::error() << boost::format( MODE_SWITCH_ERROR_MSG ) % mPendingMode;
+      }
+      branch.hasPendingMode = false;
+   }
+   // outside of the lock, the element may report the command and the receiver may request another mode right away
+   if ( !command.empty() )
+   {
+      replayCommand( branch, command );
+   }
+}
+
+void CGstRecognizerPipeline::applyPendingProfiles( DecoderBranch& branch, bool live )
+{
+   boost::lock_guard<boost::mutex> lock( mModeGuard );
+   const DecoderPtr& decoder = branch.decoder;
+   if ( branch.pendingProfiles.empty() || !decoder )
+   {
+      return;
+   }
+   if ( live && decoder->isInSpeech() )
+   {
+      // wait for the end of the utterance
+      return;
+   }
+   size_t starts = decoder->getUtteranceStarts();
+   for ( std::map<int, std::string>::const_iterator it = branch.pendingProfiles.begin(); it != branch.pendingProfiles.end(); ++it )
+   {
+      api::asr::RecognizerMode::eRecognizerMode mode = static_cast<api::asr::RecognizerMode::eRecognizerMode>( it->first );
+      if ( decoder->setProfile( mode, it->second ) )
+      {
+         GST_CAT_DEBUG( recognizer_debug, "Recognizer mode %d of %s uses the %s profile", it->first,
+            branch.language.c_str(), it->second.c_str() );
+      }
+      else
+      {
+         CLogger::error() << boost::format( PROFILE_ERROR_MSG ) % it->second % it->first;
+      }
+   }
+   branch.pendingProfiles.clear();
+   if ( decoder->getUtteranceStarts() != starts )
+   {
+      // the active search was recreated in a new utterance
+      branch.utteranceStart = branch.history.getPosition();
+   }
+}
+
+void CGstRecognizerPipeline::trackKeyword( DecoderBranch& branch )
+{
+   const DecoderPtr& decoder = branch.decoder;
+   if ( !decoder || decoder->getActiveMode() != api::asr::RecognizerMode::KEY_WORD_SEARCH )
+   {
+      return;
+   }
+   // the segments are searched only when a keyword is detected
+   std::string hypothesis = decoder->getHypothesis();
+   if ( hypothesis == branch.keywordHypothesis )
+   {
+      return;
+   }
+   branch.keywordHypothesis = hypothesis;
+   if ( hypothesis.empty() )
+   {
+      // a new utterance
+      return;
+   }
+   int endFrame = decoder->getHypothesisEndFrame();
+   if ( endFrame < 0 )
+   {
+      return;
+   }
+   boost::uint64_t frameRate = decoder->getFrameRate();
+   boost::lock_guard<boost::mutex> lock( mModeGuard );
+   branch.keywordEnd = branch.utteranceStart + ( endFrame + 1 ) * DECODER_SAMPLE_RATE / frameRate;
+   branch.hasKeywordEnd = true;
+}
+
+bool CGstRecognizerPipeline::readCommand( DecoderBranch& branch, std::vector<short>& samples )
+{
+   if ( !branch.hasKeywordEnd || !branch.history.read( branch.keywordEnd, samples ) )
+   {
+      return false;
+   }
+   branch.hasKeywordEnd = false;
+   return true;
+}
+
+void CGstRecognizerPipeline::replayCommand( DecoderBranch& branch, const std::vector<short>& samples )
+{
+   GST_CAT_DEBUG( recognizer_debug, "Replaying %u samples after the keyword", static_cast<unsigned int>( samples.size() ) );
+   // the element checks for the end of speech after every buffer, so a command said in full is finalized too;
+   // the element starts the utterance for the new search itself if the keyword utterance is over
+   for ( size_t offset = 0; offset < samples.size(); offset += REPLAY_CHUNK_SAMPLES )
+   {
+      injectAudio( branch, &samples[ offset ], std::min<size_t>( REPLAY_CHUNK_SAMPLES, samples.size() - offset ) );
+   }
+}
+
+void CGstRecognizerPipeline::injectAudio( DecoderBranch& branch, const short* samples, size_t count )
+{
+   GstBuffer* buffer = gst_buffer_new_allocate( NULL, count * sizeof( short ), NULL );
+   gst_buffer_fill( buffer, 0, samples, count * sizeof( short ) );
+   // before the chain, the element may finalize the utterance on these samples and the next one starts after them
+   branch.history.write( samples, count );
+   // we are in the streaming thread of the decoder already, the stream lock is recursive
+   branch.isInjecting = true;
+   gst_pad_chain( branch.element.getSinkPad().raw(), buffer );
+   branch.isInjecting = false;
+}
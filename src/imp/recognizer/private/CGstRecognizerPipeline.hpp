@@ -9,25 +9,88 @@
 #pragma once
 
 #include <string>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <atomic>
 #include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/thread.hpp>
+#include <boost/chrono.hpp>
+#include <boost/chrono/thread_clock.hpp>
 
 #include "imp/gstreamer/CGstPipeline.hpp"
+#include "CVoiceActivityGate.hpp"
+#include "CAudioRingBuffer.hpp"
+#include "api/IRecognizer.hpp"
+#include "api/INBestList.hpp"
 
 class CDecoder;
 typedef boost::shared_ptr<CDecoder> DecoderPtr;
 
+/**
+ * Hypothesis reported by the pipeline.
+ */
+struct HypothesisData
+{
+   std::string text;                         ///< Recognized text
+   std::string language;                     ///< Language of the decoder which recognized the text
+   bool isFinal;                             ///< false for partial results of the current utterance
+   long confidence;                          ///< Confidence reported by the pocketsphinx element
+   double score;                             ///< Posterior probability of the text, compares results of different decoders
+   api::asr::NBestListPtr alternatives;      ///< N best hypotheses of the final result if requested
+   bool hasMetrics;                          ///< Metrics are measured for final results only
+   api::asr::UtteranceMetrics metrics;       ///< Everything but the result latency
+   boost::chrono::steady_clock::time_point endOfSpeech;   ///< When the audio ending the speech reached the decoder
+
+   HypothesisData( void )
+      : isFinal( false )
+      , confidence( 0 )
+      , score( 0.0 )
+      , hasMetrics( false )
+   {
+
+   }
+};
+
+/**
+ * Hypothesis callback prototype.
+ */
+typedef boost::function<void ( const HypothesisData& )> HypothesisCallback;
+
+/**
+ * Model files of one decoder of the pipeline.
+ */
+struct DecoderModel
+{
+   std::string language;
+   std::string hmmDir;      ///< Directory with an acoustic model files
+   std::string dictFile;    ///< Pronunciation dictionary
+
+   DecoderModel( const std::string& _language, const std::string& _hmmDir, const std::string& _dictFile )
+      : language( _language )
+      , hmmDir( _hmmDir )
+      , dictFile( _dictFile )
+   {
+
+   }
+};
+
 class CGstRecognizerPipeline
 {
 public:
    typedef boost::shared_ptr<GMainLoop> MainLoopPtr;
 
    /**
-    * Constructs the pipeline with pocketsphinx element.
-    * @param hmmDir - path to the directory with an acoustic model files.
-    * @param dictFile - path to the pronunciation dictionary
+    * Constructs the pipeline with a pocketsphinx element per model.
+    * The audio is captured, resampled and gated once and teed into all decoders,
+    * each of several decoders runs in its own streaming thread.
+    * Every utterance is reported once, by the decoder with the highest posterior probability of its text;
+    * the slower decoders have half a second after the first final to catch up.
+    * @param models - decoders to create, at least one
     */
-   CGstRecognizerPipeline( const std::string& hmmDir, const std::string& dictFile );
+   explicit CGstRecognizerPipeline( const std::vector<DecoderModel>& models );
    ~CGstRecognizerPipeline( void );
 
    /**
@@ -54,11 +117,114 @@ public:
    void stopListening( void );
 
    /**
-    * Get the underlying pocketsphinx decoder.
+    * Get the decoder of the first model.
     */
    DecoderPtr getDecoder( void );
 
+   /**
+    * Get the decoder of the language.
+    * @return empty pointer if the pipeline has no such language
+    */
+   DecoderPtr getDecoder( const std::string& language );
+
+   /**
+    * Get the languages of the decoders in the construction order.
+    */
+   std::vector<std::string> getLanguages( void ) const;
+
+   /**
+    * Activate the search in all decoders, the pipeline must not be listening.
+    */
+   bool activateMode( api::asr::RecognizerMode::eRecognizerMode mode );
+
+   /**
+    * Set the function to receive partial and final hypotheses.
+    * It is called from the main loop thread.
+    * Partial hypotheses come from the decoder whose language won the last utterance.
+    */
+   void setHypothesisCallback( const HypothesisCallback& callback );
+
+   /**
+    * Set the number of alternatives collected for final results, 0 disables them.
+    * The lattice is generated only when it is not 0.
+    */
+   void setNBestSize( size_t count );
+
+   /**
+    * Switch the decoder search without stopping the audio capture.
+    * The switch happens in the streaming thread at the next utterance boundary,
+    * if the pipeline is stopped before that it happens on stop.
+    * Switching from the keyword search to the grammar search replays the audio
+    * captured after the keyword, so a command said right after it is not lost.
+    * If the whole command is in the replayed audio, its final hypothesis is reported
+    * from the streaming thread.
+    */
+   void requestMode( api::asr::RecognizerMode::eRecognizerMode mode );
+
+   /**
+    * Set the pruning profile of the search in all decoders without stopping the audio capture.
+    * Like requestMode() the search is recreated at the next utterance boundary or on stop.
+    */
+   void requestProfile( api::asr::RecognizerMode::eRecognizerMode mode, const std::string& profile );
+
+   /**
+    * Set how long the audio has to stay silent before the utterance of the search is ended.
+    * The endpointer ends the utterance and reports its final hypothesis itself,
+    * without waiting for the decoder VAD to hear the end of speech.
+    * @param milliseconds - trailing silence, 0 (default) leaves the endpointing to the decoder
+    */
+   void setEndpointHangover( api::asr::RecognizerMode::eRecognizerMode mode, unsigned int milliseconds );
+
+   /**
+    * Configure the voice activity gate in front of the decoder.
+    * Silent audio is dropped before it reaches pocketsphinx, the statistics are kept.
+    */
+   void setVoiceActivityParams( const CVoiceActivityGate::Params& params );
+
+   /**
+    * Get the number of analysed and skipped audio frames.
+    */
+   CVoiceActivityGate::Statistics getVoiceActivityStatistics( void );
+
 private:
+   /**
+    * One decoder fed from the shared capture.
+    */
+   struct DecoderBranch: boost::noncopyable
+   {
+      std::string language;
+      CGstElement element;
+      DecoderPtr decoder;
+      CAudioRingBuffer history;   ///< Audio in the order the decoder sees it
+      boost::chrono::steady_clock::time_point lastAudioTime;   ///< Arrival of the last buffer, streaming thread only
+      boost::chrono::thread_clock::time_point chainStart;   ///< Streaming thread CPU clock when the buffer in hand arrived
+      boost::chrono::thread_clock::duration utteranceCpu;   ///< Streaming thread CPU time of the current utterance so far
+      boost::uint64_t utteranceStart;   ///< Position in history where the current utterance of the decoder starts
+      boost::uint64_t keywordEnd;   ///< position in history
+      bool hasKeywordEnd;
+      std::string keywordHypothesis;   ///< The keywords tracked in the current utterance, streaming thread only
+      bool hasPendingMode;
+      bool isInjecting;   ///< Audio of our own is passing the decoder probe, streaming thread only
+      std::map<int, std::string> pendingProfiles;   ///< Pruning profiles per search to apply
+      CVoiceActivityGate silenceDetector;   ///< Classifies the audio the decoder sees, streaming thread only
+      size_t trailingSilence;               ///< Samples since the last speech, streaming thread only
+      bool isEndpointed;   ///< The endpointer ended the utterance, the element final of the flush frame is dropped
+
+      DecoderBranch( const std::string& _language, const CGstElement& _element );
+   };
+
+   typedef boost::shared_ptr<DecoderBranch> DecoderBranchPtr;
+   typedef std::vector<DecoderBranchPtr> DecoderBranchList;
+
+   static std::string makePipelineSpec( size_t decoders );
+
+   /**
+    * Make the capture part of the pipeline. The source is pinned to the decoder format,
+    * audioconvert and audioresample are added only if the device can't deliver it.
+    * The device caps are queried for the first pipeline only, the later ones reuse them.
+    */
+   static std::string makeCaptureSpec( void );
+
    CGstRecognizerPipeline* self( void );
    bool initialize( void );
    void deinitialize( void );
@@ -68,13 +234,147 @@ private:
     */
    void onBusCall( GstBus* bus, GstMessage* msg );
 
+   /**
+    * Bus sync handler. Called in the streaming thread right after the element
+    * finishes the utterance, so the decoder still has its lattice.
+    */
+   void onBusSync( GstBus* bus, GstMessage* msg );
+
+   /**
+    * Tee sink pad probe. Drops silent buffers and replays the pre-roll on speech onset.
+    * Called in the capture streaming thread, once for all decoders.
+    */
+   GstPadProbeReturn onAudioBuffer( GstPadProbeInfo* info );
+
+   /**
+    * Decoder sink pad probe. Switches the search between utterances and keeps the history.
+    * Called in the streaming thread of the decoder.
+    */
+   GstPadProbeReturn onDecoderBuffer( DecoderBranch* branch, GstPadProbeInfo* info );
+
+   /**
+    * Decoder source pad probe. The element has processed the buffer, its CPU time goes to the utterance.
+    * Called in the streaming thread of the decoder.
+    */
+   GstPadProbeReturn onDecodedBuffer( DecoderBranch* branch, GstPadProbeInfo* info );
+
+   void clearPreroll( void );
+
+   /**
+    * Log the caps negotiated at the source and at the decoders.
+    */
+   void auditCaps( void );
+
+   DecoderBranchPtr findBranch( GstObject* element ) const;
+
+   /**
+    * Apply the requested search if there is one.
+    * @param live - true when called from the streaming thread of the decoder
+    */
+   void applyPendingMode( DecoderBranch& branch, bool live );
+
+   /**
+    * Apply the requested pruning profiles if there are any.
+    * @param live - true when called from the streaming thread of the decoder
+    */
+   void applyPendingProfiles( DecoderBranch& branch, bool live );
+
+   /**
+    * End the utterance if the silence after the speech is longer than the hangover of the search.
+    * Called in the streaming thread of the decoder, between two audio chunks.
+    * The element is flushed with a frame of silence, so the next chunk starts a new utterance in it.
+    * @return true if the utterance is ended, the hypothesis is set then
+    */
+   bool endpointUtterance( DecoderBranch& branch, HypothesisData& result );
+
+   /**
+    * Remember where the keyword detected by the current utterance ends.
+    * The frames of the utterance are counted from its start position in the history.
+    */
+   void trackKeyword( DecoderBranch& branch );
+
+   /**
+    * Take the audio after the keyword from the history.
+    * @return false if there is no keyword to replay the command after
+    */
+   bool readCommand( DecoderBranch& branch, std::vector<short>& samples );
+
+   /**
+    * Feed the audio after the keyword to the just activated grammar search.
+    * The audio goes through the element, so it starts and finalizes the utterance as usual.
+    */
+   void replayCommand( DecoderBranch& branch, const std::vector<short>& samples );
+
+   /**
+    * Push the samples to the decoder element from its streaming thread, bypassing the decoder probe.
+    * The samples are appended to the history, it keeps everything the decoder sees.
+    */
+   void injectAudio( DecoderBranch& branch, const short* samples, size_t count );
+
+   /**
+    * Measure the utterance the decoder has just finished and collect its alternatives.
+    * Called in the streaming thread of the decoder.
+    */
+   void collectFinalData( DecoderBranch& branch, HypothesisData& result );
+
+   /**
+    * Collect the final hypotheses of an utterance from all decoders and report the best one.
+    * An utterance is complete when every decoder finalized it or one of them finalized the next one.
+    * The finals of the decoders which are late are dropped, see flushLateFinals().
+    */
+   void submitFinal( const HypothesisData& hypothesis );
+
+   /**
+    * Report the utterance if the other decoders did not finalize it in time after the first one.
+    * Called in the streaming threads of the decoders and from the main loop when the deadline expires.
+    */
+   void flushLateFinals( void );
+
+   /**
+    * Main loop timeout armed by the first final of an utterance, the silence after it
+    * is gated away from the decoders, so their probes can't flush the finals until the next speech.
+    */
+   static gboolean onFinalDeadline( gpointer pipeline );
+
+   /**
+    * Remove the deadline timeout if it is armed, mCallbackGuard must be held.
+    */
+   void cancelFinalDeadline( void );
+
+   /**
+    * Report the best of the collected final hypotheses, if there are any.
+    */
+   void flushFinals( void );
+   void reportBest( const std::vector<HypothesisData>& finals );
+
+   void notifyHypothesis( const HypothesisData& hypothesis );
+
 private:
    bool mListening;
    bool mIsEosReceived;
    CGstPipeline mPipeline;
-   CGstElement mPocketSphinx;
+   CGstElement mTee;
+   DecoderBranchList mBranches;
    MainLoopPtr mLoop;
-   DecoderPtr mDecoder;
    boost::mutex mEosGuard;
    boost::condition_variable mEosCondition;
+   HypothesisCallback mHypothesisCallback;
+   size_t mNBestSize;
+   std::deque<std::pair<GstMessage*, HypothesisData> > mPendingFinals;   ///< Collected in onBusSync()
+   std::deque<GstMessage*> mDroppedFinals;   ///< Finals of the utterances started by the endpointer
+   std::vector<HypothesisData> mUtteranceFinals;   ///< Finals of the current utterance, one per decoder
+   boost::chrono::steady_clock::time_point mFirstFinalTime;   ///< When the first final of the current utterance came
+   std::multiset<std::string> mLateLanguages;   ///< Decoders whose finals of the reported utterances are not in yet
+   std::string mPartialLanguage;
+   boost::mutex mCallbackGuard;
+   CVoiceActivityGate mVoiceGate;
+   std::deque<GstBuffer*> mPreroll;
+   size_t mPrerollSamples;
+   bool mReplayingPreroll;
+   std::atomic<bool> mCapsAudited;   ///< The negotiated caps of this capture are logged
+   guint mDeadlineSource;   ///< Main loop timeout of the current utterance finals, 0 if none, guarded by mCallbackGuard
+   boost::mutex mVoiceGateGuard;
+   api::asr::RecognizerMode::eRecognizerMode mPendingMode;
+   std::map<int, unsigned int> mEndpointHangovers;   ///< Milliseconds per search
+   boost::mutex mModeGuard;
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CLanguageFiles.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Locations of the language pack files
+ ************************************************************************/
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include "CLanguageFiles.hpp"
+
+static const char* DEFAULT_LANG_DIR = "lang";
+static const char* DEFAULT_CACHE_DIR = "cache";
+static const char* KEY_FILE_EXTENSION = ".key";
+static const char* DICT_FILE_EXTENSION = ".dic";
+static const char* GRAMMAR_FILE_EXTENSION = ".jsgf";
+
+CLanguageFiles::CLanguageFiles( const std::string& language, const std::string& langDir )
+   : mLanguage( language )
+   , mModelDir( ( boost::filesystem::path( langDir ) / language ).string() )
+{
+}
+
+std::string CLanguageFiles::getDefaultLangDir( void )
+{
+   return DEFAULT_LANG_DIR;
+}
+
+std::vector<std::string> CLanguageFiles::getAvailableLanguages( const std::string& langDir )
+{
+   std::vector<std::string> result;
+   boost::system::error_code error;
+   for ( boost::filesystem::directory_iterator it( langDir, error ), end; !error && it != end; it.increment( error ) )
+   {
+      std::string language = it->path().filename().string();
+      if ( boost::filesystem::is_regular_file( CLanguageFiles( language, langDir ).getDictFile(), error ) )
+      {
+         result.push_back( language );
+      }
+   }
+   std::sort( result.begin(), result.end() );
+   return result;
+}
+
+std::string CLanguageFiles::getLanguage( void ) const
+{
+   return mLanguage;
+}
+
+std::string CLanguageFiles::getModelDir( void ) const
+{
+   return mModelDir;
+}
+
+std::string CLanguageFiles::getDictFile( void ) const
+{
+   return getLanguageFile( DICT_FILE_EXTENSION );
+}
+
+std::string CLanguageFiles::getKeyFile( void ) const
+{
+   return getLanguageFile( KEY_FILE_EXTENSION );
+}
+
+std::string CLanguageFiles::getGrammarFile( void ) const
+{
+   return getLanguageFile( GRAMMAR_FILE_EXTENSION );
+}
+
+api::asr::KeyPhraseList CLanguageFiles::readKeyPhrases( void ) const
+{
+   api::asr::KeyPhraseList result;
+   std::ifstream stream( getKeyFile().c_str() );
+   std::string line;
+   while ( std::getline( stream, line ) )
+   {
+      // "phrase /threshold/", the threshold is optional
+      size_t slash = line.find( '/' );
+      std::string phrase = boost::trim_copy( line.substr( 0, slash ) );
+      if ( !phrase.empty() )
+      {
+         double threshold = ( slash != std::string::npos ) ? std::atof( line.c_str() + slash + 1 ) : 0.0;
+         result.push_back( api::asr::KeyPhrase( phrase, threshold ) );
+      }
+   }
+   return result;
+}
+
+std::string CLanguageFiles::getCacheDir( void ) const
+{
+   return ( boost::filesystem::path( DEFAULT_CACHE_DIR ) / mLanguage ).string();
+}
+
+std::string CLanguageFiles::getLanguageFile( const char* extension ) const
+{
+   return ( boost::filesystem::path( mModelDir ) / ( mLanguage + extension ) ).string();
+}
@@ -0,0 +1,67 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CLanguageFiles.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Locations of the language pack files
+ ************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "api/IRecognizer.hpp"
+
+/**
+ * Resolves the files of a language pack, for example:
+ * lang/ru-RU/ (acoustic model), lang/ru-RU/ru-RU.dic, lang/ru-RU/ru-RU.key, lang/ru-RU/ru-RU.jsgf
+ */
+class CLanguageFiles
+{
+public:
+   /**
+    * @param language - language name, for example "ru-RU"
+    * @param langDir - the directory with all language packs
+    */
+   explicit CLanguageFiles( const std::string& language, const std::string& langDir = getDefaultLangDir() );
+
+   /**
+    * Get the directory with all language packs.
+    */
+   static std::string getDefaultLangDir( void );
+
+   /**
+    * Find the language packs, the directories which have a dictionary named after them.
+    * @return sorted language names
+    */
+   static std::vector<std::string> getAvailableLanguages( const std::string& langDir = getDefaultLangDir() );
+
+   std::string getLanguage( void ) const;
+
+   /**
+    * Get the directory with an acoustic model files.
+    */
+   std::string getModelDir( void ) const;
+   std::string getDictFile( void ) const;
+   std::string getKeyFile( void ) const;
+   std::string getGrammarFile( void ) const;
+
+   /**
+    * Read the key phrases of the language pack, the lines of the key file with their /thresholds/.
+    * @return empty list if the file can't be read
+    */
+   api::asr::KeyPhraseList readKeyPhrases( void ) const;
+
+   /**
+    * Get the directory for the files generated from the language pack, for example cache/ru-RU
+    */
+   std::string getCacheDir( void ) const;
+
+private:
+   std::string getLanguageFile( const char* extension ) const;
+
+private:
+   std::string mLanguage;
+   std::string mModelDir;
+};
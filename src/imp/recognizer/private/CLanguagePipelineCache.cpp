@@ -0,0 +1,266 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CLanguagePipelineCache.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Cache of initialized recognizer pipelines per language
+ ************************************************************************/
+#include <algorithm>
+#include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+
+#include "CLanguagePipelineCache.hpp"
+#include "CGstRecognizerPipeline.hpp"
+#include "CDecoder.hpp"
+#include "CLanguageFiles.hpp"
+#include "CGrammarCache.hpp"
+#include "imp/logger/CLogger.hpp"
+
+static const char* RECOGNIZER_KWS_ERROR_MSG = "Unable to configure key word recognition. Aborting.";
+static const char* RECOGNIZER_VR_ERROR_MSG = "Unable to configure voice recognition. Aborting.";
+static const char* LANGUAGE_ERROR_MSG = "Can't load the language %1%: %2%";
+static const char* PARALLEL_SEPARATOR = "+";
+static const char* LOAD_TIMING_MSG = "Language %1% startup: decoders %2% ms (model %3% bytes), "
+   "key phrases %4% ms, grammar %5% ms, total %6% ms";
+
+static double secondsSince( const boost::chrono::steady_clock::time_point& start )
+{
+   return boost::chrono::duration<double>( boost::chrono::steady_clock::now() - start ).count();
+}
+
+static int toMilliseconds( double seconds )
+{
+   return static_cast<int>( seconds * 1000.0 + 0.5 );
+}
+
+/**
+ * Total size of the regular files in the directory, not recursive.
+ */
+static size_t directorySize( const std::string& directory )
+{
+   size_t result = 0;
+   boost::system::error_code error;
+   for ( boost::filesystem::directory_iterator it( directory, error ), end; !error && it != end; it.increment( error ) )
+   {
+      boost::system::error_code sizeError;
+      if ( boost::filesystem::is_regular_file( it->status() ) )
+      {
+         boost::uintmax_t size = boost::filesystem::file_size( it->path(), sizeError );
+         result += sizeError ? 0 : static_cast<size_t>( size );
+      }
+   }
+   return result;
+}
+
+/**
+ * TODO: make common hpp and cpp files and move utility functions to it.
+ */
+static void THROW_FATAL( const std::string&  message )
+{
+   CLogger::fatal() << message;
+   throw std::runtime_error( message );
+}
+
+static void RUN_CHECKED( bool operationResult, const std::string& errorMessage )
+{
+   if ( !operationResult )
+   {
+      THROW_FATAL( errorMessage );
+   }
+}
+
+CLanguagePipelineCache::CLanguagePipelineCache( size_t maxResident )
+   : mMaxResident( std::max<size_t>( 1, maxResident ) )
+{
+}
+
+CLanguagePipelineCache::~CLanguagePipelineCache( void )
+{
+   for ( ThreadList::iterator it = mLoaders.begin(); it != mLoaders.end(); ++it )
+   {
+      ( *it )->join();
+   }
+}
+
+std::string CLanguagePipelineCache::getParallelKey( const std::vector<std::string>& languages )
+{
+   return boost::algorithm::join( languages, PARALLEL_SEPARATOR );
+}
+
+CLanguagePipelineCache::GstRecognizerPipelinePtr CLanguagePipelineCache::get( const std::string& language )
+{
+   boost::unique_lock<boost::mutex> lock( mGuard );
+   EntryPtr entry = touch( language );
+   mLoadedCondition.wait( lock, [entry]( void ){ return !entry->loading; } );
+   GstRecognizerPipelinePtr result = entry->pipeline;
+   if ( !result )
+   {
+      // forget the failure so the next request tries again
+      remove( entry );
+      THROW_FATAL( str( boost::format( LANGUAGE_ERROR_MSG ) % language % entry->error ) );
+   }
+   return result;
+}
+
+void CLanguagePipelineCache::preload( const std::string& language )
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   touch( language );
+}
+
+bool CLanguagePipelineCache::isLoaded( const std::string& language )
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   EntryIndex::const_iterator it = mIndex.find( language );
+   return ( it != mIndex.end() ) && !( *it->second )->loading && ( *it->second )->pipeline;
+}
+
+api::asr::LanguageLoadTiming CLanguagePipelineCache::getLoadTiming( const std::string& language ) const
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   EntryIndex::const_iterator it = mIndex.find( language );
+   bool isLoaded = ( it != mIndex.end() ) && !( *it->second )->loading;
+   return isLoaded ? ( *it->second )->timing : api::asr::LanguageLoadTiming();
+}
+
+size_t CLanguagePipelineCache::getMaxResident( void ) const
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   return mMaxResident;
+}
+
+void CLanguagePipelineCache::setMaxResident( size_t maxResident )
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   mMaxResident = std::max<size_t>( 1, maxResident );
+   evict();
+}
+
+CLanguagePipelineCache::EntryPtr CLanguagePipelineCache::touch( const std::string& language )
+{
+   EntryIndex::iterator it = mIndex.find( language );
+   if ( it != mIndex.end() )
+   {
+      mEntries.splice( mEntries.begin(), mEntries, it->second );
+   }
+   else
+   {
+      mEntries.push_front( EntryPtr( new Entry( language ) ) );
+      mIndex[ language ] = mEntries.begin();
+      pruneLoaders();
+      mLoaders.push_back( ThreadPtr( new boost::thread( boost::bind( &CLanguagePipelineCache::load, this, mEntries.front() ) ) ) );
+      evict();
+   }
+   return mEntries.front();
+}
+
+void CLanguagePipelineCache::remove( const EntryPtr& entry )
+{
+   EntryIndex::iterator it = mIndex.find( entry->language );
+   if ( it != mIndex.end() && *it->second == entry )
+   {
+      mEntries.erase( it->second );
+      mIndex.erase( it );
+   }
+}
+
+void CLanguagePipelineCache::load( const EntryPtr& entry )
+{
+   const std::string& language = entry->language;
+   CLogger::debug() << "Loading language " << language;
+   GstRecognizerPipelinePtr pipeline;
+   api::asr::LanguageLoadTiming timing;
+   std::string error;
+   try
+   {
+      pipeline = createPipeline( language, timing );
+   }
+   catch ( const std::exception& e )
+   {
+      error = e.what();
+   }
+   {
+      boost::lock_guard<boost::mutex> lock( mGuard );
+      entry->pipeline = pipeline;
+      entry->timing = timing;
+      entry->error = error;
+      entry->loading = false;
+      evict();
+   }
+   mLoadedCondition.notify_all();
+   CLogger::debug() << "Language " << language << ( pipeline ? " is loaded" : " failed to load" );
+   if ( pipeline )
+   {
+      CLogger::info() << boost::format( LOAD_TIMING_MSG ) % language % toMilliseconds( timing.decoderInit )
+         % timing.modelBytes % toMilliseconds( timing.keyPhrases ) % toMilliseconds( timing.grammar )
+         % toMilliseconds( timing.total );
+   }
+}
+
+void CLanguagePipelineCache::pruneLoaders( void )
+{
+   ThreadList::iterator it = mLoaders.begin();
+   while ( it != mLoaders.end() )
+   {
+      // does not wait, a loader which is still running is checked again next time
+      if ( ( *it )->try_join_for( boost::chrono::milliseconds( 0 ) ) )
+      {
+         it = mLoaders.erase( it );
+      }
+      else
+      {
+         ++it;
+      }
+   }
+}
+
+void CLanguagePipelineCache::evict( void )
+{
+   // entries which are being loaded are skipped, the loader needs them
+   EntryList::iterator it = mEntries.end();
+   while ( mEntries.size() > mMaxResident && it != mEntries.begin() )
+   {
+      --it;
+      if ( !( *it )->loading )
+      {
+         CLogger::debug() << "Language " << ( *it )->language << " is evicted from the cache";
+         mIndex.erase( ( *it )->language );
+         it = mEntries.erase( it );
+      }
+   }
+}
+
+CLanguagePipelineCache::GstRecognizerPipelinePtr CLanguagePipelineCache::createPipeline( const std::string& language,
+   api::asr::LanguageLoadTiming& timing )
+{
+   boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+   std::vector<std::string> languages;
+   boost::algorithm::split( languages, language, boost::algorithm::is_any_of( PARALLEL_SEPARATOR ) );
+   std::vector<DecoderModel> decoderModels;
+   for ( size_t i = 0; i < languages.size(); ++i )
+   {
+      CLanguageFiles files( languages[ i ] );
+      decoderModels.push_back( DecoderModel( languages[ i ], files.getModelDir(), files.getDictFile() ) );
+      timing.modelBytes += directorySize( files.getModelDir() );
+   }
+
+   boost::chrono::steady_clock::time_point stage = boost::chrono::steady_clock::now();
+   GstRecognizerPipelinePtr pipeline( new CGstRecognizerPipeline( decoderModels ) );
+   timing.decoderInit = secondsSince( stage );
+   for ( size_t i = 0; i < languages.size(); ++i )
+   {
+      CLanguageFiles files( languages[ i ] );
+      DecoderPtr decoder = pipeline->getDecoder( languages[ i ] );
+      stage = boost::chrono::steady_clock::now();
+      RUN_CHECKED( decoder->setKeyFile( files.getKeyFile() ), RECOGNIZER_KWS_ERROR_MSG );
+      timing.keyPhrases += secondsSince( stage );
+      stage = boost::chrono::steady_clock::now();
+      RUN_CHECKED( CGrammarCache( files ).apply( *decoder ), RECOGNIZER_VR_ERROR_MSG );
+      timing.grammar += secondsSince( stage );
+   }
+   timing.total = secondsSince( start );
+   return pipeline;
+}
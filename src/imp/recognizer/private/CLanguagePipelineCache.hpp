@@ -0,0 +1,131 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CLanguagePipelineCache.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Cache of initialized recognizer pipelines per language
+ ************************************************************************/
+#pragma once
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "api/IRecognizer.hpp"
+
+class CGstRecognizerPipeline;
+
+/**
+ * Keeps fully configured recognizer pipelines (READY state, key phrase file
+ * and grammar are set) for recently used languages.
+ * Languages are loaded lazily on the first request or in the background by preload().
+ * The least recently used pipelines are dropped when the limit is exceeded,
+ * a pipeline that is still referenced by the caller stays alive until it is released.
+ * A key made by getParallelKey() stands for one pipeline decoding several languages at once.
+ */
+class CLanguagePipelineCache: boost::noncopyable
+{
+public:
+   typedef boost::shared_ptr<CGstRecognizerPipeline> GstRecognizerPipelinePtr;
+
+   /**
+    * @param maxResident - how many languages to keep loaded, at least one
+    */
+   explicit CLanguagePipelineCache( size_t maxResident );
+
+   /**
+    * Waits for the background loads to finish.
+    */
+   ~CLanguagePipelineCache( void );
+
+   /**
+    * Make the key of the pipeline which decodes all the languages in parallel.
+    */
+   static std::string getParallelKey( const std::vector<std::string>& languages );
+
+   /**
+    * Get the pipeline of the language.
+    * Blocks if the language is not loaded yet or is being loaded in the background.
+    * Throws std::runtime_error if the language can't be loaded.
+    */
+   GstRecognizerPipelinePtr get( const std::string& language );
+
+   /**
+    * Start loading the language in the background, returns immediately.
+    */
+   void preload( const std::string& language );
+
+   /**
+    * Check whether the language is loaded and ready to use.
+    */
+   bool isLoaded( const std::string& language );
+
+   /**
+    * Get the startup time breakdown of the language.
+    * @return zeros if the language is not loaded
+    */
+   api::asr::LanguageLoadTiming getLoadTiming( const std::string& language ) const;
+
+   size_t getMaxResident( void ) const;
+
+   /**
+    * Change the resident languages limit, evicts extra pipelines immediately.
+    */
+   void setMaxResident( size_t maxResident );
+
+private:
+   struct Entry
+   {
+      std::string language;
+      GstRecognizerPipelinePtr pipeline;
+      api::asr::LanguageLoadTiming timing;
+      bool loading;
+      std::string error;
+
+      explicit Entry( const std::string& _language )
+         : language( _language )
+         , pipeline()
+         , timing()
+         , loading( true )
+         , error()
+      {
+
+      }
+   };
+
+   typedef boost::shared_ptr<Entry> EntryPtr;
+   typedef std::list<EntryPtr> EntryList;
+   typedef std::map<std::string, EntryList::iterator> EntryIndex;
+   typedef boost::shared_ptr<boost::thread> ThreadPtr;
+   typedef std::list<ThreadPtr> ThreadList;
+
+   /**
+    * Find the entry and mark it as most recently used, start loading it if it is absent.
+    * Must be called under mGuard.
+    */
+   EntryPtr touch( const std::string& language );
+   void remove( const EntryPtr& entry );
+   void load( const EntryPtr& entry );
+   void evict( void );
+
+   /**
+    * Join the loaders which have finished.
+    * Must be called under mGuard.
+    */
+   void pruneLoaders( void );
+
+   static GstRecognizerPipelinePtr createPipeline( const std::string& language, api::asr::LanguageLoadTiming& timing );
+
+private:
+   size_t mMaxResident;
+   EntryList mEntries;   ///< Most recently used first
+   EntryIndex mIndex;
+   ThreadList mLoaders;   ///< Guarded by mGuard, finished loaders are joined when the next one starts
+   mutable boost::mutex mGuard;
+   boost::condition_variable mLoadedCondition;
+};
@@ -0,0 +1,29 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CNBestList.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Recognition alternatives stored in the utterance arena
+ ************************************************************************/
+#include <cassert>
+
+#include "CNBestList.hpp"
+
+CNBestList::CNBestList( const UtteranceArenaPtr& arena, const api::asr::RecognitionAlternative* alternatives, size_t count )
+   : mArena( arena )
+   , mAlternatives( alternatives )
+   , mCount( count )
+{
+}
+
+size_t CNBestList::getSize( void ) const
+{
+   return mCount;
+}
+
+const api::asr::RecognitionAlternative& CNBestList::getAlternative( size_t index ) const
+{
+   assert( index < mCount );
+   return mAlternatives[ index ];
+}
@@ -0,0 +1,38 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CNBestList.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Recognition alternatives stored in the utterance arena
+ ************************************************************************/
+#pragma once
+
+#include "api/INBestList.hpp"
+#include "CUtteranceArena.hpp"
+
+class CNBestList: public api::asr::INBestList
+{
+public:
+   /**
+    * @param arena - memory of the alternatives, kept while the list exists
+    * @param alternatives - array allocated in the arena
+    * @param count - number of alternatives in the array
+    */
+   CNBestList( const UtteranceArenaPtr& arena, const api::asr::RecognitionAlternative* alternatives, size_t count );
+
+   /**
+    * @sa api::asr::INBestList::getSize()
+    */
+   virtual size_t getSize( void ) const;
+
+   /**
+    * @sa api::asr::INBestList::getAlternative()
+    */
+   virtual const api::asr::RecognitionAlternative& getAlternative( size_t index ) const;
+
+private:
+   UtteranceArenaPtr mArena;
+   const api::asr::RecognitionAlternative* mAlternatives;
+   size_t mCount;
+};
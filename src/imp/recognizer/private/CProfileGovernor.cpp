@@ -0,0 +1,69 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CProfileGovernor.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Steps the decoder profiles down when decoding falls behind
+ ************************************************************************/
+#include <algorithm>
+#include <boost/thread/lock_guard.hpp>
+
+#include "CProfileGovernor.hpp"
+
+static const double AVERAGE_WEIGHT = 0.3;     ///< Weight of the last utterance in the average
+static const double STEP_UP_FRACTION = 0.5;   ///< Step back up when the average is below this part of the limit
+static const size_t MIN_UTTERANCES = 3;       ///< Utterances decoded with a profile before the next step
+
+CProfileGovernor::CProfileGovernor( void )
+   : mLimit( 0.0 )
+{
+}
+
+void CProfileGovernor::setLimit( double maxRealTimeFactor )
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   mLimit = maxRealTimeFactor;
+   mModes.clear();
+}
+
+size_t CProfileGovernor::update( api::asr::RecognizerMode::eRecognizerMode mode, double realTimeFactor, size_t requestedLevel )
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   if ( mLimit <= 0.0 )
+   {
+      return requestedLevel;
+   }
+   ModeState& state = mModes[ mode ];
+   state.averageFactor = ( state.utterances == 0 ) ? realTimeFactor
+      : AVERAGE_WEIGHT * realTimeFactor + ( 1.0 - AVERAGE_WEIGHT ) * state.averageFactor;
+   ++state.utterances;
+   size_t steps = std::min( state.steps, requestedLevel );
+   if ( state.utterances >= MIN_UTTERANCES )
+   {
+      // the average starts over, the previous one was measured with another profile
+      if ( state.averageFactor > mLimit && steps < requestedLevel )
+      {
+         ++steps;
+         state.utterances = 0;
+      }
+      else if ( state.averageFactor < mLimit * STEP_UP_FRACTION && steps > 0 )
+      {
+         --steps;
+         state.utterances = 0;
+      }
+   }
+   state.steps = steps;
+   return requestedLevel - steps;
+}
+
+size_t CProfileGovernor::getLevel( api::asr::RecognizerMode::eRecognizerMode mode, size_t requestedLevel ) const
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   std::map<int, ModeState>::const_iterator it = mModes.find( mode );
+   if ( mLimit <= 0.0 || it == mModes.end() )
+   {
+      return requestedLevel;
+   }
+   return requestedLevel - std::min( it->second.steps, requestedLevel );
+}
@@ -0,0 +1,64 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CProfileGovernor.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Steps the decoder profiles down when decoding falls behind
+ ************************************************************************/
+#pragma once
+
+#include <map>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "api/IRecognizer.hpp"
+
+/**
+ * Watches the real time factor of the decoded utterances per search mode.
+ * When its average gets above the limit the mode steps down to a cheaper profile,
+ * when it drops well below the limit the mode steps back up, never above the requested profile.
+ * Profiles are levels: 0 is the cheapest one.
+ */
+class CProfileGovernor: boost::noncopyable
+{
+public:
+   CProfileGovernor( void );
+
+   /**
+    * @param maxRealTimeFactor - CPU time per second of audio the decoder may spend, 0 disables the governor
+    */
+   void setLimit( double maxRealTimeFactor );
+
+   /**
+    * Account the utterance decoded by the mode.
+    * @param requestedLevel - profile level requested for the mode
+    * @return profile level the mode has to use
+    */
+   size_t update( api::asr::RecognizerMode::eRecognizerMode mode, double realTimeFactor, size_t requestedLevel );
+
+   /**
+    * Get the profile level the mode has to use without accounting an utterance.
+    */
+   size_t getLevel( api::asr::RecognizerMode::eRecognizerMode mode, size_t requestedLevel ) const;
+
+private:
+   struct ModeState
+   {
+      double averageFactor;   ///< Exponential moving average of the real time factor
+      size_t utterances;      ///< Utterances since the last step
+      size_t steps;           ///< Levels below the requested one
+
+      ModeState( void )
+         : averageFactor( 0.0 )
+         , utterances( 0 )
+         , steps( 0 )
+      {
+
+      }
+   };
+
+   double mLimit;
+   std::map<int, ModeState> mModes;
+   mutable boost::mutex mGuard;
+};
@@ -0,0 +1,146 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CRecognizerMetrics.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Rolling statistics of the recognized utterances
+ ************************************************************************/
+#include <algorithm>
+#include <limits>
+#include <boost/format.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include "CRecognizerMetrics.hpp"
+#include "imp/logger/CLogger.hpp"
+
+using namespace api::asr;
+
+static const char* METRICS_MSG = "%1%: %2% utterances, audio %3$.2f s, xRT mean %4$.3f p90 %5$.3f, "
+   "latency p50 %6$.0f ms p90 %7$.0f ms max %8$.0f ms, frames p90 %9$.0f";
+
+static const double SECONDS_BOUNDS[] = { 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0, 10.0 };
+static const double FACTOR_BOUNDS[] = { 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0 };
+static const double FRAMES_BOUNDS[] = { 50, 100, 200, 500, 1000, 2000, 5000 };
+
+static const char* modeName( int mode )
+{
+   switch ( mode )
+   {
+   case RecognizerMode::KEY_WORD_SEARCH:
+      return "KEY_WORD_SEARCH";
+   case RecognizerMode::GRAMMAR_SEARCH:
+      return "GRAMMAR_SEARCH";
+   default:
+      return "NONE";
+   }
+}
+
+template <size_t N>
+static std::vector<double> makeBounds( const double ( &bounds )[ N ] )
+{
+   std::vector<double> result( bounds, bounds + N );
+   result.push_back( std::numeric_limits<double>::infinity() );
+   return result;
+}
+
+static std::vector<double> boundsOf( UtteranceMetric::eUtteranceMetric metric )
+{
+   switch ( metric )
+   {
+   case UtteranceMetric::REAL_TIME_FACTOR:
+      return makeBounds( FACTOR_BOUNDS );
+   case UtteranceMetric::FRAMES:
+      return makeBounds( FRAMES_BOUNDS );
+   default:
+      return makeBounds( SECONDS_BOUNDS );
+   }
+}
+
+/**
+ * Value at the rank in the sorted values, the position rank * ( size - 1 ) is rounded to the closest element.
+ */
+static double percentile( const std::vector<double>& sorted, double rank )
+{
+   size_t index = static_cast<size_t>( rank * ( sorted.size() - 1 ) + 0.5 );
+   return sorted[ std::min( index, sorted.size() - 1 ) ];
+}
+
+CRecognizerMetrics::CRecognizerMetrics( size_t window )
+   : mWindow( std::max<size_t>( window, 1 ) )
+{
+}
+
+void CRecognizerMetrics::record( const UtteranceMetrics& metrics )
+{
+   boost::lock_guard<boost::mutex> lock( mGuard );
+   MetricsWindow& utterances = mUtterances[ metrics.mode ];
+   utterances.push_back( metrics );
+   if ( utterances.size() > mWindow )
+   {
+      utterances.pop_front();
+   }
+}
+
+MetricsHistogram CRecognizerMetrics::getHistogram( UtteranceMetric::eUtteranceMetric metric,
+   RecognizerMode::eRecognizerMode mode ) const
+{
+   MetricsHistogram result;
+   result.upperBounds = boundsOf( metric );
+   result.counts.resize( result.upperBounds.size(), 0 );
+
+   std::vector<double> values;
+   {
+      boost::lock_guard<boost::mutex> lock( mGuard );
+      std::map<int, MetricsWindow>::const_iterator it = mUtterances.find( mode );
+      if ( it != mUtterances.end() )
+      {
+         values.reserve( it->second.size() );
+         for ( MetricsWindow::const_iterator utterance = it->second.begin(); utterance != it->second.end(); ++utterance )
+         {
+            values.push_back( utterance->get( metric ) );
+         }
+      }
+   }
+   if ( values.empty() )
+   {
+      return result;
+   }
+
+   std::sort( values.begin(), values.end() );
+   double sum = 0.0;
+   for ( size_t i = 0; i < values.size(); ++i )
+   {
+      sum += values[ i ];
+      size_t bucket = std::lower_bound( result.upperBounds.begin(), result.upperBounds.end(), values[ i ] ) - result.upperBounds.begin();
+      ++result.counts[ bucket ];
+   }
+   result.samples = static_cast<unsigned int>( values.size() );
+   result.mean = sum / values.size();
+   result.median = percentile( values, 0.5 );
+   result.p90 = percentile( values, 0.9 );
+   result.max = values.back();
+   return result;
+}
+
+void CRecognizerMetrics::dump( void ) const
+{
+   std::vector<int> modes;
+   {
+      boost::lock_guard<boost::mutex> lock( mGuard );
+      for ( std::map<int, MetricsWindow>::const_iterator it = mUtterances.begin(); it != mUtterances.end(); ++it )
+      {
+         modes.push_back( it->first );
+      }
+   }
+   for ( size_t i = 0; i < modes.size(); ++i )
+   {
+      RecognizerMode::eRecognizerMode mode = static_cast<RecognizerMode::eRecognizerMode>( modes[ i ] );
+      MetricsHistogram audio = getHistogram( UtteranceMetric::AUDIO_DURATION, mode );
+      MetricsHistogram factor = getHistogram( UtteranceMetric::REAL_TIME_FACTOR, mode );
+      MetricsHistogram latency = getHistogram( UtteranceMetric::RESULT_LATENCY, mode );
+      MetricsHistogram frames = getHistogram( UtteranceMetric::FRAMES, mode );
+      CLogger::info() << str( boost::format( METRICS_MSG ) % modeName( mode ) % audio.samples % ( audio.mean * audio.samples )
+         % factor.mean % factor.p90 % ( latency.median * 1000 ) % ( latency.p90 * 1000 ) % ( latency.max * 1000 ) % frames.p90 );
+   }
+}
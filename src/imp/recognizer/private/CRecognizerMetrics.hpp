@@ -0,0 +1,45 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CRecognizerMetrics.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Rolling statistics of the recognized utterances
+ ************************************************************************/
+#pragma once
+
+#include <deque>
+#include <map>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "api/IRecognizer.hpp"
+
+/**
+ * Keeps the metrics of the last utterances per search mode
+ * and builds histograms of them on request.
+ */
+class CRecognizerMetrics: boost::noncopyable
+{
+public:
+   /**
+    * @param window - number of the last utterances kept per mode
+    */
+   explicit CRecognizerMetrics( size_t window = 256 );
+
+   void record( const api::asr::UtteranceMetrics& metrics );
+
+   api::asr::MetricsHistogram getHistogram( api::asr::UtteranceMetric::eUtteranceMetric metric,
+      api::asr::RecognizerMode::eRecognizerMode mode ) const;
+
+   /**
+    * Log the summary of every mode that has utterances.
+    */
+   void dump( void ) const;
+
+private:
+   typedef std::deque<api::asr::UtteranceMetrics> MetricsWindow;
+   size_t mWindow;
+   std::map<int, MetricsWindow> mUtterances;
+   mutable boost::mutex mGuard;
+};
@@ -8,12 +8,20 @@
  ************************************************************************/
 #include <gst/gst.h>
 #include <glib.h>
+#include <algorithm>
 #include <boost/format.hpp>
 #include <boost/thread.hpp>
+#include <boost/chrono.hpp>
+#include <boost/algorithm/string.hpp>
 
 #include "imp/recognizer/CSphinxRecognizer.hpp"
 #include "imp/recognizer/private/CGstRecognizerPipeline.hpp"
 #include "imp/recognizer/private/CDecoder.hpp"
+#include "imp/recognizer/private/CLanguagePipelineCache.hpp"
+#include "imp/recognizer/private/CLanguageFiles.hpp"
+#include "imp/recognizer/private/CGrammarBuilder.hpp"
+#include "imp/recognizer/private/CGrammarCache.hpp"
+#include "imp/g2p/CRussianG2P.hpp"
 #include "imp/logger/CLogger.hpp"
 
 using namespace api::asr;
@@ -21,14 +29,20 @@ using namespace api::asr;
 /**
  * TODO: create IConfigurable interface
  */
-static const char* DEFAULT_LANG_DIR = "lang";
 static const char* DEFAULT_LANGUAGE = "ru-RU";
-static const char* KEY_FILE_EXTENSION = ".key";
-static const char* DICT_FILE_EXTENSION = ".dic";
-static const char* GRAMMAR_FILE_EXTENSION = ".jsgf";
 static const char* RECOGNIZER_ERROR_MSG = "Recognizer may be in inconsistent state. Aborting.";
-static const char* RECOGNIZER_KWS_ERROR_MSG = "Unable to configure key word recognition. Aborting.";
 static const char* RECOGNIZER_VR_ERROR_MSG = "Unable to configure voice recognition. Aborting.";
+static const char* RECOGNIZER_KWS_ERROR_MSG = "Unable to configure key word recognition. Aborting.";
+static const char* GRAMMAR_READ_ERROR_MSG = "Can't read the grammar %1%";
+static const char* GRAMMAR_RULE_ERROR_MSG = "The grammar has no rule <%1%>";
+static const char* GRAMMAR_WORD_ERROR_MSG = "'%1%' is not a valid grammar token, it is left out of the rule <%2%>";
+static const char* PHONETIZE_MSG = "Phonetized group '%1%': %2% words, %3% new in the dictionary, %4% ms";
+static const char* PROFILE_STEP_MSG = "Recognizer mode %1% averages xRT %2$.2f, switching its profile from %3% to %4%";
+static const char* BARGE_IN_MSG = "Key phrase '%1%' is recognized in the command mode";
+static const char* CONVERTER_ERROR_MSG = "There is no grapheme-to-phoneme converter for %1%";
+static const char* DEFAULT_PROFILE = "command";
+static const char* KEY_PHRASE_RULE = "key_phrase";   ///< Grammar rule with the key phrases
+static const unsigned int COMMAND_HANGOVER_MS = 400;   ///< A pause inside a command is shorter
 
 /**
  * TODO: make common hpp and cpp files and move utility functions to it.
@@ -47,35 +61,229 @@ static void RUN_CHECKED( bool operationResult, const std::string& errorMessage )
    }
 }
 
-CSphinxRecognizer::CSphinxRecognizer( void )
+/**
+ * Check whether the words of the phrase follow each other in the text.
+ */
+static bool containsPhrase( const std::string& text, const std::string& phrase )
+{
+   std::string trimmedPhrase = boost::trim_copy( phrase );
+   std::string trimmedText = boost::trim_copy( text );
+   if ( trimmedPhrase.empty() || trimmedText.empty() )
+   {
+      return false;
+   }
+   std::vector<std::string> words;
+   std::vector<std::string> phraseWords;
+   boost::split( words, trimmedText, boost::is_space(), boost::token_compress_on );
+   boost::split( phraseWords, trimmedPhrase, boost::is_space(), boost::token_compress_on );
+   return std::search( words.begin(), words.end(), phraseWords.begin(), phraseWords.end() ) != words.end();
+}
+
+/**
+ * @return position of the profile in CDecoder::getProfileNames(), their number if there is no such profile
+ */
+static size_t getProfileLevel( const std::string& profile )
+{
+   std::vector<std::string> names = CDecoder::getProfileNames();
+   return std::find( names.begin(), names.end(), profile ) - names.begin();
+}
+
+CSphinxRecognizer::CSphinxRecognizer( size_t residentLanguages )
    : mLanguage( DEFAULT_LANGUAGE )
    , mMode( RecognizerMode::KEY_WORD_SEARCH )
+   , mPipelineCache( new CLanguagePipelineCache( residentLanguages ) )
+   , mPartialInterval( 0 )
+   , mNBestSize( 0 )
 {
+   mProfiles[ RecognizerMode::KEY_WORD_SEARCH ] = DEFAULT_PROFILE;
+   mProfiles[ RecognizerMode::GRAMMAR_SEARCH ] = DEFAULT_PROFILE;
+   // the key phrase is short, the decoder endpointing is fast enough for it
+   mEndpointHangovers[ RecognizerMode::KEY_WORD_SEARCH ] = 0;
+   mEndpointHangovers[ RecognizerMode::GRAMMAR_SEARCH ] = COMMAND_HANGOVER_MS;
    reinit();
 }
 
 void CSphinxRecognizer::reinit( void )
 {
-   std::string langDir( DEFAULT_LANG_DIR );
-   langDir += "\\" + mLanguage;
-   std::string dictDir = langDir + "\\" + mLanguage + std::string( DICT_FILE_EXTENSION );
-   std::string keyFile = langDir + "\\" + mLanguage + std::string( KEY_FILE_EXTENSION );
-   std::string grammarFile = langDir + "\\" + mLanguage + std::string( GRAMMAR_FILE_EXTENSION );
-   mRecognizerPipeline.reset( new CGstRecognizerPipeline( langDir, dictDir ) );
-   DecoderPtr decoder = mRecognizerPipeline->getDecoder();
-   RUN_CHECKED( decoder->setKeyFile( keyFile ), RECOGNIZER_KWS_ERROR_MSG );
-   RUN_CHECKED( decoder->setGrammarFile( grammarFile ), RECOGNIZER_VR_ERROR_MSG );
-   RUN_CHECKED( decoder->activateMode( mMode ), RECOGNIZER_VR_ERROR_MSG );
+   // cached pipelines are kept in the READY state, switching is a pointer swap
+   if ( mRecognizerPipeline )
+   {
+      mRecognizerPipeline->setHypothesisCallback( HypothesisCallback() );
+   }
+   mRecognizerPipeline = mPipelineCache->get( getPipelineKey() );
+   // the callback runs in the pipeline threads, it must not read mRecognizerPipeline the app thread reassigns
+   mRecognizerPipeline->setHypothesisCallback( boost::bind( &CSphinxRecognizer::onHypothesis, this,
+      boost::weak_ptr<CGstRecognizerPipeline>( mRecognizerPipeline ), _1 ) );
+   mRecognizerPipeline->setNBestSize( mNBestSize );
+   for ( std::map<int, unsigned int>::const_iterator it = mEndpointHangovers.begin(); it != mEndpointHangovers.end(); ++it )
+   {
+      mRecognizerPipeline->setEndpointHangover( static_cast<RecognizerMode::eRecognizerMode>( it->first ), it->second );
+   }
+   std::vector<std::string> languages = mRecognizerPipeline->getLanguages();
+   for ( size_t i = 0; i < languages.size(); ++i )
+   {
+      updateBargeInPhrases( languages[ i ] );
+      if ( !mGroups[ languages[ i ] ].empty() && mPhonetizedPipelines[ languages[ i ] ].lock() != mRecognizerPipeline )
+      {
+         // the pipeline was reloaded since the last phonetize()
+         size_t newWords = 0;
+         RUN_CHECKED( applyGroups( languages[ i ], newWords ), RECOGNIZER_VR_ERROR_MSG );
+      }
+      std::map<std::string, boost::weak_ptr<CGstRecognizerPipeline> >::const_iterator keyPhrases = mKeyPhrasePipelines.find( languages[ i ] );
+      if ( keyPhrases != mKeyPhrasePipelines.end() && keyPhrases->second.lock() != mRecognizerPipeline )
+      {
+         // the phrases were changed on another pipeline
+         RUN_CHECKED( applyKeyPhrases( languages[ i ] ), RECOGNIZER_KWS_ERROR_MSG );
+      }
+   }
+   // decoders already using the profiles skip it
+   applyProfile( RecognizerMode::KEY_WORD_SEARCH );
+   applyProfile( RecognizerMode::GRAMMAR_SEARCH );
+   RUN_CHECKED( mRecognizerPipeline->activateMode( mMode ), RECOGNIZER_VR_ERROR_MSG );
+}
+
+std::string CSphinxRecognizer::getPipelineKey( void ) const
+{
+   return mParallelLanguages.empty() ? mLanguage : CLanguagePipelineCache::getParallelKey( mParallelLanguages );
+}
+
+bool CSphinxRecognizer::applyGroups( const std::string& language, size_t& newWords )
+{
+   newWords = 0;
+   CLanguageFiles files( language );
+   CGrammarBuilder grammar( "" );
+   if ( !CGrammarBuilder::fromFile( files.getGrammarFile(), grammar ) )
+   {
+      CLogger::error() << str( boost::format( GRAMMAR_READ_ERROR_MSG ) % files.getGrammarFile() );
+      return false;
+   }
+
+   DecoderPtr decoder = mRecognizerPipeline->getDecoder( language );
+   const GroupMap& groups = mGroups[ language ];
+   for ( GroupMap::const_iterator it = groups.begin(); it != groups.end(); ++it )
+   {
+      std::vector<std::string> words;
+      words.reserve( it->second.size() );
+      for ( size_t i = 0; i < it->second.size(); ++i )
+      {
+         words.push_back( it->second[ i ].first );
+         if ( !CGrammarBuilder::isValidPhrase( words.back() ) )
+         {
+            CLogger::error() << str( boost::format( GRAMMAR_WORD_ERROR_MSG ) % words.back() % it->first );
+         }
+      }
+      if ( !grammar.setRule( it->first, words ) )
+      {
+         CLogger::error() << str( boost::format( GRAMMAR_RULE_ERROR_MSG ) % it->first );
+         return false;
+      }
+      newWords += decoder->addWordsToDict( it->second );
+   }
+   const KeyPhraseList& keyPhrases = mKeyPhrases[ language ];
+   if ( !keyPhrases.empty() )
+   {
+      // the grammar search spots the key phrases in the command mode with the same acoustic scores
+      std::vector<std::string> phrases;
+      for ( size_t i = 0; i < keyPhrases.size(); ++i )
+      {
+         phrases.push_back( keyPhrases[ i ].phrase );
+      }
+      if ( !grammar.setRule( KEY_PHRASE_RULE, phrases ) )
+      {
+         // every language pack is expected to have it, the key phrases can't interrupt a command then
+         CLogger::warning() << str( boost::format( GRAMMAR_RULE_ERROR_MSG ) % KEY_PHRASE_RULE );
+      }
+   }
+
+   // the only search rebuild for the whole update, the same groups after a restart are not compiled again
+   bool result = CGrammarCache( files, grammar.getGrammar() ).apply( *decoder );
+   if ( result && mMode != RecognizerMode::NONE )
+   {
+      result = decoder->activateMode( mMode );
+   }
+   if ( result )
+   {
+      mPhonetizedPipelines[ language ] = mRecognizerPipeline;
+   }
+   return result;
+}
+
+bool CSphinxRecognizer::applyKeyPhrases( const std::string& language )
+{
+   DecoderPtr decoder = mRecognizerPipeline->getDecoder( language );
+   const KeyPhraseList& phrases = mKeyPhrases[ language ];
+   bool result = phrases.empty() ? decoder->setKeyFile( CLanguageFiles( language ).getKeyFile() )
+      : decoder->setKeyPhrases( phrases );
+   // the key phrases are in the grammar too, rebuilding it activates the mode again
+   size_t newWords = 0;
+   result = result && applyGroups( language, newWords );
+   if ( result )
+   {
+      mKeyPhrasePipelines[ language ] = mRecognizerPipeline;
+   }
+   updateBargeInPhrases( language );
+   return result;
+}
+
+void CSphinxRecognizer::updateBargeInPhrases( const std::string& language )
+{
+   KeyPhraseList phrases = mKeyPhrases[ language ];
+   if ( phrases.empty() )
+   {
+      phrases = CLanguageFiles( language ).readKeyPhrases();
+   }
+   std::set<std::string> texts;
+   for ( size_t i = 0; i < phrases.size(); ++i )
+   {
+      texts.insert( phrases[ i ].phrase );
+   }
+   boost::lock_guard<boost::mutex> lock( mBargeInGuard );
+   mBargeInPhrases[ language ].swap( texts );
+}
+
+void CSphinxRecognizer::applyProfile( RecognizerMode::eRecognizerMode mode )
+{
+   mRecognizerPipeline->requestProfile( mode, getDecoderProfile( mode ) );
 }
 
-api::asr::RecognizerPtr CSphinxRecognizer::create( void )
+void CSphinxRecognizer::governProfile( const boost::weak_ptr<CGstRecognizerPipeline>& pipeline, const UtteranceMetrics& metrics )
 {
-   return RecognizerPtr( new CSphinxRecognizer() );
+   std::string previous;
+   std::string profile;
+   {
+      boost::lock_guard<boost::mutex> lock( mProfileGuard );
+      std::map<int, std::string>::const_iterator it = mProfiles.find( metrics.mode );
+      if ( it == mProfiles.end() )
+      {
+         return;
+      }
+      std::vector<std::string> names = CDecoder::getProfileNames();
+      size_t requestedLevel = getProfileLevel( it->second );
+      previous = names[ mGovernor.getLevel( metrics.mode, requestedLevel ) ];
+      profile = names[ mGovernor.update( metrics.mode, metrics.realTimeFactor, requestedLevel ) ];
+   }
+   if ( profile != previous )
+   {
+      CLogger::info() << str( boost::format( PROFILE_STEP_MSG ) % metrics.mode % metrics.realTimeFactor
+         % previous % profile );
+      GstRecognizerPipelinePtr measured = pipeline.lock();
+      if ( measured )
+      {
+         measured->requestProfile( metrics.mode, profile );
+      }
+   }
+}
+
+api::asr::RecognizerPtr CSphinxRecognizer::create( size_t residentLanguages )
+{
+   return RecognizerPtr( new CSphinxRecognizer( residentLanguages ) );
 }
 
 
 CSphinxRecognizer::~CSphinxRecognizer( void )
 {
+   mRecognizerPipeline->setHypothesisCallback( HypothesisCallback() );
+   mMetrics.dump();
 }
 
 
@@ -87,8 +295,62 @@ std::string CSphinxRecognizer::getLanguage( void ) const
 
 void CSphinxRecognizer::setLanguage( const std::string& language )
 {
-   mLanguage = language;
-   reinit();
+   if ( language != mLanguage || !mParallelLanguages.empty() )
+   {
+      // the previous pipeline stays in the cache, it must not keep capturing
+      stopListening();
+      mLanguage = language;
+      mParallelLanguages.clear();
+      reinit();
+   }
+}
+
+
+void CSphinxRecognizer::preloadLanguage( const std::string& language )
+{
+   mPipelineCache->preload( language );
+}
+
+
+std::vector<std::string> CSphinxRecognizer::getAvailableLanguages( void ) const
+{
+   return CLanguageFiles::getAvailableLanguages();
+}
+
+
+bool CSphinxRecognizer::setParallelLanguages( const std::vector<std::string>& languages )
+{
+   const std::vector<std::string>& requested = languages.empty() ? getAvailableLanguages() : languages;
+   std::vector<std::string> unique;
+   for ( size_t i = 0; i < requested.size(); ++i )
+   {
+      if ( std::find( unique.begin(), unique.end(), requested[ i ] ) == unique.end() )
+      {
+         unique.push_back( requested[ i ] );
+      }
+   }
+   if ( unique.size() < 2 )
+   {
+      if ( !unique.empty() )
+      {
+         setLanguage( unique.front() );
+      }
+      return !unique.empty();
+   }
+   if ( unique != mParallelLanguages )
+   {
+      stopListening();
+      mLanguage = unique.front();
+      mParallelLanguages = unique;
+      reinit();
+   }
+   return true;
+}
+
+
+std::vector<std::string> CSphinxRecognizer::getParallelLanguages( void ) const
+{
+   return mParallelLanguages.empty() ? std::vector<std::string>( 1, mLanguage ) : mParallelLanguages;
 }
 
 
@@ -101,14 +363,23 @@ api::asr::RecognizerMode::eRecognizerMode CSphinxRecognizer::getMode( void ) con
 bool CSphinxRecognizer::setMode( api::asr::RecognizerMode::eRecognizerMode mode )
 {
    bool result = false;
-   if ( !mRecognizerPipeline->isListening() )
+   if ( mRecognizerPipeline->isListening() )
    {
-      DecoderPtr decoder = mRecognizerPipeline->getDecoder();
-      if ( decoder )
+      // the capture keeps running, the search is switched between utterances
+      result = ( mode != RecognizerMode::NONE );
+      if ( result && mode != mMode )
       {
-         result = decoder->activateMode( mode );
+         mRecognizerPipeline->requestMode( mode );
       }
    }
+   else
+   {
+      result = mRecognizerPipeline->activateMode( mode );
+   }
+   if ( result )
+   {
+      mMode = mode;
+   }
    return result;
 }
 
@@ -116,7 +387,13 @@ bool CSphinxRecognizer::setMode( api::asr::RecognizerMode::eRecognizerMode mode
 bool CSphinxRecognizer::listen( void )
 {
    bool result = false;
-   if ( !mRecognizerPipeline->isListening() && mMode != RecognizerMode::NONE )
+   if ( mRecognizerPipeline->isListening() )
+   {
+      // a live mode switch keeps listening
+      result = true;
+      mStartListening( StartListeningData( mMode, result ) );
+   }
+   else if ( mMode != RecognizerMode::NONE )
    {
       result = mRecognizerPipeline->startListening();
       mStartListening( StartListeningData( mMode, result ) );
@@ -142,7 +419,116 @@ void CSphinxRecognizer::stopListening( void )
 
 bool CSphinxRecognizer::phonetize( const std::string& group, const GraphemePhonemeList& g2pList )
 {
-   return false;
+   bool result = false;
+   if ( !mRecognizerPipeline->isListening() )
+   {
+      boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+      GroupMap& groups = mGroups[ mLanguage ];
+      GroupMap::iterator it = groups.find( group );
+      bool isNewGroup = ( it == groups.end() );
+      GraphemePhonemeList previous = isNewGroup ? GraphemePhonemeList() : it->second;
+
+      // the previous words of the group leave the grammar, so they can't be recognized anymore;
+      // pocketsphinx can't remove words from the dictionary, they stay there unused
+      groups[ group ] = g2pList;
+      size_t newWords = 0;
+      result = applyGroups( mLanguage, newWords );
+      if ( !result )
+      {
+         if ( isNewGroup )
+         {
+            groups.erase( group );
+         }
+         else
+         {
+            groups[ group ] = previous;
+         }
+      }
+
+      boost::chrono::milliseconds elapsed = boost::chrono::duration_cast<boost::chrono::milliseconds>(
+         boost::chrono::steady_clock::now() - start );
+      CLogger::info() << str( boost::format( PHONETIZE_MSG ) % group % g2pList.size()
+         % newWords % elapsed.count() );
+   }
+   return result;
+}
+
+bool CSphinxRecognizer::phonetizeNames( const std::string& group, const std::vector<std::string>& names )
+{
+   GraphemeToPhonemePtr& converter = mConverters[ mLanguage ];
+   if ( !converter )
+   {
+      GraphemeToPhonemePtr russian = CRussianG2P::create();
+      if ( russian->getLanguage() != mLanguage )
+      {
+         mConverters.erase( mLanguage );
+         CLogger::error() << str( boost::format( CONVERTER_ERROR_MSG ) % mLanguage );
+         return false;
+      }
+      converter = russian;
+   }
+   return phonetize( group, converter->convertAll( names ) );
+}
+
+bool CSphinxRecognizer::setKeyPhrases( const KeyPhraseList& phrases )
+{
+   bool result = false;
+   if ( !mRecognizerPipeline->isListening() )
+   {
+      KeyPhraseList previous = mKeyPhrases[ mLanguage ];
+      mKeyPhrases[ mLanguage ] = phrases;
+      result = applyKeyPhrases( mLanguage );
+      if ( !result )
+      {
+         mKeyPhrases[ mLanguage ] = previous;
+         applyKeyPhrases( mLanguage );
+      }
+   }
+   return result;
+}
+
+bool CSphinxRecognizer::setDecoderProfile( RecognizerMode::eRecognizerMode mode, const std::string& profile )
+{
+   if ( mode == RecognizerMode::NONE || getProfileLevel( profile ) >= CDecoder::getProfileNames().size() )
+   {
+      return false;
+   }
+   {
+      boost::lock_guard<boost::mutex> lock( mProfileGuard );
+      mProfiles[ mode ] = profile;
+   }
+   applyProfile( mode );
+   return true;
+}
+
+std::string CSphinxRecognizer::getDecoderProfile( RecognizerMode::eRecognizerMode mode ) const
+{
+   boost::lock_guard<boost::mutex> lock( mProfileGuard );
+   std::map<int, std::string>::const_iterator it = mProfiles.find( mode );
+   if ( it == mProfiles.end() )
+   {
+      return std::string();
+   }
+   return CDecoder::getProfileNames()[ mGovernor.getLevel( mode, getProfileLevel( it->second ) ) ];
+}
+
+bool CSphinxRecognizer::setEndpointHangover( RecognizerMode::eRecognizerMode mode, unsigned int milliseconds )
+{
+   if ( mode == RecognizerMode::NONE )
+   {
+      return false;
+   }
+   mEndpointHangovers[ mode ] = milliseconds;
+   mRecognizerPipeline->setEndpointHangover( mode, milliseconds );
+   return true;
+}
+
+void CSphinxRecognizer::setProfileGovernor( double maxRealTimeFactor )
+{
+   mGovernor.setLimit( maxRealTimeFactor );
+   // the modes return to the profiles they were given
+   applyProfile( RecognizerMode::KEY_WORD_SEARCH );
+   applyProfile( RecognizerMode::GRAMMAR_SEARCH );
 }
 
 signals::connection CSphinxRecognizer::onStartListening( const api::asr::StartListeningSignal_t::slot_type& slot )
@@ -156,6 +542,96 @@ signals::connection CSphinxRecognizer::onRecognitionResult( const api::asr::Reco
 }
 
 
+signals::connection CSphinxRecognizer::onPartialResult( const api::asr::PartialResultSignal_t::slot_type& slot )
+{
+   return mPartialResult.connect( slot );
+}
+
+
+void CSphinxRecognizer::setPartialResultInterval( unsigned int milliseconds )
+{
+   boost::lock_guard<boost::mutex> lock( mPartialGuard );
+   mPartialInterval = boost::chrono::milliseconds( milliseconds );
+}
+
+
+void CSphinxRecognizer::setNBestSize( size_t count )
+{
+   mNBestSize = count;
+   mRecognizerPipeline->setNBestSize( count );
+}
+
+
+api::asr::MetricsHistogram CSphinxRecognizer::getMetricsHistogram( api::asr::UtteranceMetric::eUtteranceMetric metric,
+   api::asr::RecognizerMode::eRecognizerMode mode ) const
+{
+   return mMetrics.getHistogram( metric, mode );
+}
+
+
+void CSphinxRecognizer::dumpMetrics( void ) const
+{
+   mMetrics.dump();
+}
+
+
+api::asr::LanguageLoadTiming CSphinxRecognizer::getLoadTiming( void ) const
+{
+   return mPipelineCache->getLoadTiming( getPipelineKey() );
+}
+
+
+void CSphinxRecognizer::onHypothesis( const boost::weak_ptr<CGstRecognizerPipeline>& pipeline, const HypothesisData& data )
+{
+   const std::string& hypothesis = data.text;
+   if ( data.isFinal )
+   {
+      {
+         boost::lock_guard<boost::mutex> lock( mPartialGuard );
+         mLastPartialText.clear();
+      }
+      if ( data.hasMetrics )
+      {
+         UtteranceMetrics metrics = data.metrics;
+         metrics.resultLatency = boost::chrono::duration<double>( boost::chrono::steady_clock::now() - data.endOfSpeech ).count();
+         mMetrics.record( metrics );
+         governProfile( pipeline, metrics );
+      }
+      RecognitionResultData result( hypothesis, !hypothesis.empty(), data.confidence, data.alternatives, data.language );
+      result.mode = data.hasMetrics ? data.metrics.mode : RecognizerMode::NONE;
+      if ( result.mode == RecognizerMode::GRAMMAR_SEARCH )
+      {
+         boost::lock_guard<boost::mutex> lock( mBargeInGuard );
+         const std::set<std::string>& phrases = mBargeInPhrases[ data.language ];
+         for ( std::set<std::string>::const_iterator it = phrases.begin(); it != phrases.end(); ++it )
+         {
+            if ( containsPhrase( hypothesis, *it ) )
+            {
+               // the key phrase interrupts the command dialog, also when it is said before or after a command
+               result.mode = RecognizerMode::KEY_WORD_SEARCH;
+               CLogger::debug() << str( boost::format( BARGE_IN_MSG ) % hypothesis );
+               break;
+            }
+         }
+      }
+      mRecognitionResult( result );
+      return;
+   }
+
+   boost::chrono::steady_clock::time_point now = boost::chrono::steady_clock::now();
+   {
+      boost::lock_guard<boost::mutex> lock( mPartialGuard );
+      if ( hypothesis.empty() || hypothesis == mLastPartialText || now - mLastPartialTime < mPartialInterval )
+      {
+         return;
+      }
+      mLastPartialText = hypothesis;
+      mLastPartialTime = now;
+   }
+   mPartialResult( PartialResultData( hypothesis ) );
+}
+
+
 signals::connection CSphinxRecognizer::onStopListening( const api::asr::StopListeningSignal_t::slot_type& slot )
 {
    return mStopListening.connect( slot );
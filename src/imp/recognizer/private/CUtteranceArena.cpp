@@ -0,0 +1,96 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CUtteranceArena.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Bump allocator for the results of one utterance
+ ************************************************************************/
+#include <cstring>
+#include <algorithm>
+#include <boost/thread.hpp>
+
+#include "CUtteranceArena.hpp"
+
+static const size_t BLOCK_SIZE = 16 * 1024;
+static const size_t ALIGNMENT = 16;
+static const size_t MAX_POOLED_ARENAS = 4;
+
+static std::vector<CUtteranceArena*> sPool;
+static boost::mutex sPoolGuard;
+
+UtteranceArenaPtr CUtteranceArena::acquire( void )
+{
+   CUtteranceArena* arena = NULL;
+   {
+      boost::lock_guard<boost::mutex> lock( sPoolGuard );
+      if ( !sPool.empty() )
+      {
+         arena = sPool.back();
+         sPool.pop_back();
+      }
+   }
+   return UtteranceArenaPtr( ( arena != NULL ) ? arena : new CUtteranceArena(), &CUtteranceArena::release );
+}
+
+void CUtteranceArena::release( CUtteranceArena* arena )
+{
+   arena->reset();
+   {
+      boost::lock_guard<boost::mutex> lock( sPoolGuard );
+      if ( sPool.size() < MAX_POOLED_ARENAS )
+      {
+         sPool.push_back( arena );
+         return;
+      }
+   }
+   delete arena;
+}
+
+CUtteranceArena::CUtteranceArena( void )
+   : mCurrentBlock( 0 )
+   , mOffset( 0 )
+{
+}
+
+CUtteranceArena::~CUtteranceArena( void )
+{
+   for ( size_t i = 0; i < mBlocks.size(); ++i )
+   {
+      delete[] mBlocks[ i ].first;
+   }
+}
+
+void* CUtteranceArena::allocate( size_t size )
+{
+   size = ( size + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 );
+   while ( mCurrentBlock < mBlocks.size() && mOffset + size > mBlocks[ mCurrentBlock ].second )
+   {
+      ++mCurrentBlock;
+      mOffset = 0;
+   }
+   if ( mCurrentBlock == mBlocks.size() )
+   {
+      // new [] of char is aligned for any fundamental type
+      size_t blockSize = std::max( BLOCK_SIZE, size );
+      mBlocks.push_back( Block( new char[ blockSize ], blockSize ) );
+      mOffset = 0;
+   }
+   void* result = mBlocks[ mCurrentBlock ].first + mOffset;
+   mOffset += size;
+   return result;
+}
+
+const char* CUtteranceArena::copyString( const char* text, size_t length )
+{
+   char* result = allocateArray<char>( length + 1 );
+   std::memcpy( result, text, length );
+   result[ length ] = '\0';
+   return result;
+}
+
+void CUtteranceArena::reset( void )
+{
+   mCurrentBlock = 0;
+   mOffset = 0;
+}
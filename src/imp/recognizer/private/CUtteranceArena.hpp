@@ -0,0 +1,67 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CUtteranceArena.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Bump allocator for the results of one utterance
+ ************************************************************************/
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+class CUtteranceArena;
+typedef boost::shared_ptr<CUtteranceArena> UtteranceArenaPtr;
+
+/**
+ * Memory for everything produced while walking the results of one utterance.
+ * Allocation is a pointer bump, nothing is freed one by one:
+ * when the last pointer to the arena is gone it is reset in one shot
+ * and goes back to the pool, keeping its blocks for the next utterance.
+ * Only trivially destructible objects may live here.
+ */
+class CUtteranceArena: boost::noncopyable
+{
+public:
+   /**
+    * Get an empty arena from the pool.
+    */
+   static UtteranceArenaPtr acquire( void );
+
+   ~CUtteranceArena( void );
+
+   /**
+    * Allocate the memory aligned for any fundamental type.
+    */
+   void* allocate( size_t size );
+
+   template <typename T>
+   T* allocateArray( size_t count )
+   {
+      return static_cast<T*>( allocate( sizeof( T ) * count ) );
+   }
+
+   /**
+    * Copy the string into the arena.
+    * @param length - number of characters to copy, the terminating zero is added
+    */
+   const char* copyString( const char* text, size_t length );
+
+   /**
+    * Forget all the allocations, the blocks are kept.
+    */
+   void reset( void );
+
+private:
+   CUtteranceArena( void );
+   static void release( CUtteranceArena* arena );
+
+private:
+   typedef std::pair<char*, size_t> Block;
+   std::vector<Block> mBlocks;
+   size_t mCurrentBlock;
+   size_t mOffset;
+};
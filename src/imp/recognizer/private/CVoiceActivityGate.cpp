@@ -0,0 +1,197 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CVoiceActivityGate.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Energy-based voice activity detector
+ ************************************************************************/
+#include <cmath>
+#include <algorithm>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define VAD_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "CVoiceActivityGate.hpp"
+
+static const unsigned int FRAMES_PER_SECOND = 100;
+static const double FULL_SCALE_ENERGY = 32768.0 * 32768.0;
+static const double SILENCE_DB = -100.0;
+static const double NOISE_FLOOR_ADAPTATION = 0.05;   ///< Per silent frame
+// speech has pauses between words, a run without a quiet frame that long is background noise
+static const size_t MINIMUM_WINDOW_FRAMES = 2 * FRAMES_PER_SECOND;
+
+static double toDb( double energy, size_t count )
+{
+   double power = ( count > 0 ) ? energy / ( count * FULL_SCALE_ENERGY ) : 0.0;
+   return ( power > 0.0 ) ? 10.0 * std::log10( power ) : SILENCE_DB;
+}
+
+CVoiceActivityGate::CVoiceActivityGate( const Params& params )
+   : mParams( params )
+   , mStatistics()
+   , mNoiseFloorDb( params.minEnergyDb )
+   , mRunMinimumDb( 0.0 )
+   , mRunFrames( 0 )
+   , mHangoverLeft( 0 )
+{
+}
+
+bool CVoiceActivityGate::process( const short* samples, size_t count )
+{
+   size_t frameSize = std::max<size_t>( 1, mParams.sampleRate / FRAMES_PER_SECOND );
+   bool speech = false;
+   size_t frames = 0;
+   for ( size_t offset = 0; offset < count; offset += frameSize, ++frames )
+   {
+      // every frame is analysed to keep the noise floor up to date
+      speech = isSpeechFrame( samples + offset, std::min( frameSize, count - offset ) ) || speech;
+   }
+
+   if ( !mParams.enabled || speech )
+   {
+      mHangoverLeft = static_cast<size_t>( mParams.hangoverMs ) * mParams.sampleRate / 1000;
+      speech = true;
+   }
+   else if ( mHangoverLeft > 0 )
+   {
+      mHangoverLeft -= std::min( mHangoverLeft, count );
+      speech = true;
+   }
+
+   mStatistics.totalFrames += frames;
+   mStatistics.skippedFrames += speech ? 0 : frames;
+   return speech;
+}
+
+void CVoiceActivityGate::reset( void )
+{
+   mNoiseFloorDb = mParams.minEnergyDb;
+   mRunMinimumDb = 0.0;
+   mRunFrames = 0;
+   mHangoverLeft = 0;
+}
+
+void CVoiceActivityGate::setParams( const Params& params )
+{
+   mParams = params;
+   reset();
+}
+
+const CVoiceActivityGate::Params& CVoiceActivityGate::getParams( void ) const
+{
+   return mParams;
+}
+
+CVoiceActivityGate::Statistics CVoiceActivityGate::getStatistics( void ) const
+{
+   return mStatistics;
+}
+
+bool CVoiceActivityGate::isSpeechFrame( const short* samples, size_t count )
+{
+   double energyDb = toDb( static_cast<double>( frameEnergy( samples, count ) ), count );
+   double threshold = std::max( mParams.minEnergyDb, mNoiseFloorDb + mParams.marginDb );
+   bool speech = ( energyDb > threshold );
+   if ( !speech && energyDb > threshold - mParams.marginDb / 2 && count > 1 )
+   {
+      speech = ( static_cast<double>( zeroCrossings( samples, count ) ) / ( count - 1 ) > mParams.zeroCrossingRate );
+   }
+   if ( !speech )
+   {
+      // the floor follows the background noise, never going below the silence limit
+      mNoiseFloorDb += ( std::max( energyDb, mParams.minEnergyDb ) - mNoiseFloorDb ) * NOISE_FLOOR_ADAPTATION;
+      mRunFrames = 0;
+      return false;
+   }
+   // minimum statistics over the speech run, the floor only rises this way
+   mRunMinimumDb = ( mRunFrames == 0 ) ? energyDb : std::min( mRunMinimumDb, energyDb );
+   if ( ++mRunFrames >= MINIMUM_WINDOW_FRAMES )
+   {
+      mNoiseFloorDb = std::max( mNoiseFloorDb, mRunMinimumDb );
+      mRunFrames = 0;
+   }
+   return true;
+}
+
+#ifdef VAD_USE_SSE2
+
+boost::uint64_t CVoiceActivityGate::frameEnergy( const short* samples, size_t count )
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i accumulator = zero;
+   size_t i = 0;
+   for ( ; i + 8 <= count; i += 8 )
+   {
+      __m128i values = _mm_loadu_si128( reinterpret_cast<const __m128i*>( samples + i ) );
+      // pairs of squares, at most 2 * 32768^2 = 2^31 which is exact as an unsigned 32 bit value
+      __m128i pairs = _mm_madd_epi16( values, values );
+      accumulator = _mm_add_epi64( accumulator, _mm_unpacklo_epi32( pairs, zero ) );
+      accumulator = _mm_add_epi64( accumulator, _mm_unpackhi_epi32( pairs, zero ) );
+   }
+   boost::uint64_t lanes[ 2 ];
+   _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ), accumulator );
+   boost::uint64_t result = lanes[ 0 ] + lanes[ 1 ];
+   for ( ; i < count; ++i )
+   {
+      result += static_cast<boost::uint64_t>( samples[ i ] * samples[ i ] );
+   }
+   return result;
+}
+
+size_t CVoiceActivityGate::zeroCrossings( const short* samples, size_t count )
+{
+   size_t result = 0;
+   size_t i = 0;
+   // 16 bit lane counters can't overflow within 8 * 32767 samples, flush them before that
+   static const size_t FLUSH_INTERVAL = 8 * 32767;
+   while ( i + 9 <= count )
+   {
+      __m128i counters = _mm_setzero_si128();
+      size_t end = std::min( count - 8, i + FLUSH_INTERVAL );
+      for ( ; i < end; i += 8 )
+      {
+         __m128i current = _mm_loadu_si128( reinterpret_cast<const __m128i*>( samples + i ) );
+         __m128i next = _mm_loadu_si128( reinterpret_cast<const __m128i*>( samples + i + 1 ) );
+         // the sign bit of xor is set where the signs differ, arithmetic shift makes it -1
+         counters = _mm_sub_epi16( counters, _mm_srai_epi16( _mm_xor_si128( current, next ), 15 ) );
+      }
+      short lanes[ 8 ];
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ), counters );
+      for ( size_t lane = 0; lane < 8; ++lane )
+      {
+         result += static_cast<unsigned short>( lanes[ lane ] );
+      }
+   }
+   for ( ; i + 1 < count; ++i )
+   {
+      result += ( ( samples[ i ] ^ samples[ i + 1 ] ) < 0 ) ? 1 : 0;
+   }
+   return result;
+}
+
+#else
+
+boost::uint64_t CVoiceActivityGate::frameEnergy( const short* samples, size_t count )
+{
+   boost::uint64_t result = 0;
+   for ( size_t i = 0; i < count; ++i )
+   {
+      result += static_cast<boost::uint64_t>( samples[ i ] * samples[ i ] );
+   }
+   return result;
+}
+
+size_t CVoiceActivityGate::zeroCrossings( const short* samples, size_t count )
+{
+   size_t result = 0;
+   for ( size_t i = 0; i + 1 < count; ++i )
+   {
+      result += ( ( samples[ i ] ^ samples[ i + 1 ] ) < 0 ) ? 1 : 0;
+   }
+   return result;
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CVoiceActivityGate.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Energy-based voice activity detector
+ ************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+/**
+ * Decides whether 16 bit mono PCM audio contains speech, so silence
+ * does not have to reach the decoder.
+ * The audio is analysed in 10 ms frames, a frame is speech when its energy is
+ * above the tracked noise floor by the margin, or somewhat above it with a high
+ * zero-crossing rate (fricatives like "s" are quiet but noisy).
+ * The noise floor follows the silent frames; during a long speech run it is raised
+ * to the quietest frame of the run, so a louder background can't keep the gate open forever.
+ * After the last speech frame the gate stays open for the hangover time.
+ */
+class CVoiceActivityGate
+{
+public:
+   struct Params
+   {
+      bool enabled;                 ///< false - everything is speech
+      unsigned int sampleRate;      ///< Hz
+      double minEnergyDb;           ///< Frames quieter than that are never speech, dBFS
+      double marginDb;              ///< How much louder than the noise floor speech is, dB
+      double zeroCrossingRate;      ///< Zero crossings per sample that mark a fricative frame
+      unsigned int hangoverMs;      ///< Keep passing audio after the speech, must exceed the decoder end-of-speech silence
+      unsigned int prerollMs;       ///< Audio before the speech onset replayed to the decoder
+
+      Params( void )
+         : enabled( true )
+         , sampleRate( 16000 )
+         , minEnergyDb( -55.0 )
+         , marginDb( 9.0 )
+         , zeroCrossingRate( 0.25 )
+         , hangoverMs( 1000 )
+         , prerollMs( 300 )
+      {
+
+      }
+   };
+
+   struct Statistics
+   {
+      boost::uint64_t totalFrames;     ///< 10 ms frames analysed
+      boost::uint64_t skippedFrames;   ///< 10 ms frames classified as silence
+
+      Statistics( void )
+         : totalFrames( 0 )
+         , skippedFrames( 0 )
+      {
+
+      }
+   };
+
+   explicit CVoiceActivityGate( const Params& params = Params() );
+
+   /**
+    * Analyse the next chunk of the audio stream.
+    * @return true if the chunk should reach the decoder
+    */
+   bool process( const short* samples, size_t count );
+
+   /**
+    * Forget the stream state (noise floor, hangover), statistics are kept.
+    */
+   void reset( void );
+
+   /**
+    * Change the parameters, the stream state is reset.
+    */
+   void setParams( const Params& params );
+   const Params& getParams( void ) const;
+   Statistics getStatistics( void ) const;
+
+   /**
+    * Sum of squared samples.
+    * It is computed in integers, so the vectorized and the plain versions are bit exact.
+    */
+   static boost::uint64_t frameEnergy( const short* samples, size_t count );
+
+   /**
+    * Number of sign changes between adjacent samples.
+    */
+   static size_t zeroCrossings( const short* samples, size_t count );
+
+private:
+   bool isSpeechFrame( const short* samples, size_t count );
+
+private:
+   Params mParams;
+   Statistics mStatistics;
+   double mNoiseFloorDb;
+   double mRunMinimumDb;   ///< The quietest frame of the current speech run
+   size_t mRunFrames;      ///< Speech frames in a row since the floor was last updated
+   size_t mHangoverLeft;   ///< samples
+};
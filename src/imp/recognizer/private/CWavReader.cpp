@@ -0,0 +1,146 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CWavReader.cpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Minimal RIFF/WAVE PCM reader
+ ************************************************************************/
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <boost/cstdint.hpp>
+
+#include "CWavReader.hpp"
+
+static const unsigned short WAVE_FORMAT_PCM = 1;
+static const unsigned short SUPPORTED_CHANNELS = 1;
+static const unsigned short SUPPORTED_BITS_PER_SAMPLE = 16;
+
+static const char* OPEN_ERROR_MSG = "Can't open the file";
+static const char* HEADER_ERROR_MSG = "Not a RIFF/WAVE file";
+static const char* FORMAT_ERROR_MSG = "Only 16 bit mono PCM is supported";
+static const char* DATA_ERROR_MSG = "The file has no data chunk";
+
+/**
+ * WAV fields are little-endian, read them byte by byte to stay endianness neutral.
+ */
+static boost::uint32_t readLE32( const unsigned char* data )
+{
+   return data[ 0 ] | ( data[ 1 ] << 8 ) | ( data[ 2 ] << 16 ) | ( static_cast<boost::uint32_t>( data[ 3 ] ) << 24 );
+}
+
+static boost::uint16_t readLE16( const unsigned char* data )
+{
+   return static_cast<boost::uint16_t>( data[ 0 ] | ( data[ 1 ] << 8 ) );
+}
+
+CWavReader::CWavReader( void )
+   : mSamples()
+   , mSampleRate( 0 )
+   , mError()
+{
+}
+
+bool CWavReader::read( const std::string& fileName )
+{
+   mSamples.clear();
+   mSampleRate = 0;
+   mError.clear();
+
+   std::ifstream stream( fileName.c_str(), std::ios::binary );
+   if ( !stream )
+   {
+      return fail( OPEN_ERROR_MSG );
+   }
+   stream.seekg( 0, std::ios::end );
+   const std::streamoff fileSize = stream.tellg();
+   stream.seekg( 0, std::ios::beg );
+
+   unsigned char header[ 12 ];
+   if ( !stream.read( reinterpret_cast<char*>( header ), sizeof( header ) )
+      || memcmp( header, "RIFF", 4 ) != 0
+      || memcmp( header + 8, "WAVE", 4 ) != 0 )
+   {
+      return fail( HEADER_ERROR_MSG );
+   }
+
+   bool formatFound = false;
+   unsigned char chunk[ 8 ];
+   while ( stream.read( reinterpret_cast<char*>( chunk ), sizeof( chunk ) ) )
+   {
+      boost::uint32_t chunkSize = readLE32( chunk + 4 );
+      // the size in the header is not trusted, nothing is allocated past the end of the file
+      const std::streamoff remaining = fileSize - stream.tellg();
+      if ( memcmp( chunk, "fmt ", 4 ) == 0 )
+      {
+         if ( chunkSize < 16 || chunkSize > remaining )
+         {
+            return fail( HEADER_ERROR_MSG );
+         }
+         std::vector<unsigned char> format( chunkSize );
+         if ( !stream.read( reinterpret_cast<char*>( &format[ 0 ] ), chunkSize ) )
+         {
+            return fail( HEADER_ERROR_MSG );
+         }
+         if ( readLE16( &format[ 0 ] ) != WAVE_FORMAT_PCM
+            || readLE16( &format[ 2 ] ) != SUPPORTED_CHANNELS
+            || readLE16( &format[ 14 ] ) != SUPPORTED_BITS_PER_SAMPLE )
+         {
+            return fail( FORMAT_ERROR_MSG );
+         }
+         mSampleRate = readLE32( &format[ 4 ] );
+         formatFound = true;
+      }
+      else if ( memcmp( chunk, "data", 4 ) == 0 )
+      {
+         if ( !formatFound )
+         {
+            return fail( HEADER_ERROR_MSG );
+         }
+         // streaming writers leave the data size unset, the data lasts up to the end of the file then
+         size_t dataSize = static_cast<size_t>( std::min<std::streamoff>( chunkSize, remaining ) );
+         std::vector<unsigned char> data( dataSize );
+         stream.read( reinterpret_cast<char*>( data.data() ), dataSize );
+         size_t count = static_cast<size_t>( stream.gcount() ) / 2;
+         mSamples.resize( count );
+         for ( size_t i = 0; i < count; ++i )
+         {
+            mSamples[ i ] = static_cast<short>( readLE16( &data[ i * 2 ] ) );
+         }
+         return true;
+      }
+      else
+      {
+         // chunks are padded to the even size
+         stream.seekg( chunkSize + ( chunkSize & 1 ), std::ios::cur );
+      }
+   }
+   return fail( DATA_ERROR_MSG );
+}
+
+const std::vector<short>& CWavReader::getSamples( void ) const
+{
+   return mSamples;
+}
+
+unsigned int CWavReader::getSampleRate( void ) const
+{
+   return mSampleRate;
+}
+
+double CWavReader::getDuration( void ) const
+{
+   return ( mSampleRate != 0 ) ? static_cast<double>( mSamples.size() ) / mSampleRate : 0.0;
+}
+
+std::string CWavReader::getError( void ) const
+{
+   return mError;
+}
+
+bool CWavReader::fail( const std::string& error )
+{
+   mError = error;
+   return false;
+}
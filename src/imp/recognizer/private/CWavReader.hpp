@@ -0,0 +1,47 @@
+/*************************************************************************
+ * jenkins-vr
+ *************************************************************************
+ * @file    CWavReader.hpp
+ * @date    17.10.26
+ * @author  agent
+ * @brief   Minimal RIFF/WAVE PCM reader
+ ************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Reads 16 bit mono PCM WAV files into memory.
+ * Other sample formats are rejected, the batch recognizer
+ * expects the corpus in the decoder native format.
+ */
+class CWavReader
+{
+public:
+   CWavReader( void );
+
+   /**
+    * Read the whole file.
+    * @return true on success, otherwise getError() describes the problem
+    */
+   bool read( const std::string& fileName );
+
+   const std::vector<short>& getSamples( void ) const;
+   unsigned int getSampleRate( void ) const;
+
+   /**
+    * Get audio duration in seconds.
+    */
+   double getDuration( void ) const;
+
+   std::string getError( void ) const;
+
+private:
+   bool fail( const std::string& error );
+
+private:
+   std::vector<short> mSamples;
+   unsigned int mSampleRate;
+   std::string mError;
+};
@@ -1,63 +1,119 @@
-#include <iostream>
-#include <gst/gst.h>
-#include <vector>
-
-#include "api/ITextToSpeech.hpp"
-#include "imp/logger/CLogger.hpp"
-#include "imp/player/CFilePlayer.hpp"
-#include "imp/recognizer/CSphinxRecognizer.hpp"
-#include <pocketsphinx.h>
-#include <glib.h>
-#include <glib/gstdio.h>
-
-#ifdef _WIN32
-
-#include "imp/tts/CWinTTS.hpp"
-
-#endif
-
-GST_DEBUG_CATEGORY_STATIC (app_debug);
-
-void handler1( api::tts::StartSpeakingData data )
-{
-   CLogger::info() << "StartSpeaking event: " << data.status << "; '" << data.text << "'";
-}
-
-void handler2( api::tts::StopSpeakingData data )
-{
-   CLogger::info() << "StopSpeaking event";
-}
-
-void handler3( api::player::StartPlayingData data )
-{
-   CLogger::info() << "StartPlaying event: " << data.status << "; '" << data.file << "'";
-}
-
-void handler4( api::player::StopPlayingData data )
-{
-   CLogger::info() << "StopPlaying event: " << data.file;
-}
-
-int main()
-{
-	gst_init( NULL, NULL );
-
-   GST_DEBUG_CATEGORY_INIT (app_debug, "JENKINS-VR", 0, "JENKINS-VR");
-   FILE* mLogFile = g_fopen( "logfile.txt", "w" );
-
-   if ( mLogFile )
-   {
-      bool result = true;
-      gst_debug_remove_log_function( NULL );
-      gst_debug_add_log_function( gst_debug_log_default, mLogFile, NULL );
-      gst_debug_set_threshold_from_string( "GST_TRACER:7,GST_BUFFER*:7,GST_EVENT:7,GST_MESSAGE:7,JENKINS-VR:7,pocketsphinx:7,CGstPlayerPipeline:7,CGstRecognizerPipeline:7", true );
-   }
-
-   CLogger::setConsoleLogLevel( LogLevel::LEVEL_DEBUG );
-   CLogger::fatal() << "Hello fatal! " << "This is on the same line.";
-   CLogger::error() << "Hello error! " << "This is on the same line.";
-   CLogger::warning() << "Hello warning! " << "This is on the same line.";
-   CLogger::info() << "Hello info! " << "This is on the same line.";
-   CLogger::debug() << "Hello debug! " << "This is on the same line.";
-	return 0;
+#include <iostream>
+#include <gst/gst.h>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+#include "api/ITextToSpeech.hpp"
+#include "imp/logger/CLogger.hpp"
+#include "imp/player/CFilePlayer.hpp"
+#include "imp/recognizer/CSphinxRecognizer.hpp"
+#include "imp/recognizer/CBatchRecognizer.hpp"
+#include <pocketsphinx.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#ifdef _WIN32
+
+#include "imp/tts/CWinTTS.hpp"
+
+#endif
+
+GST_DEBUG_CATEGORY_STATIC (app_debug);
+
+void handler1( api::tts::StartSpeakingData data )
+{
+   CLogger::info() << "StartSpeaking event: " << data.status << "; '" << data.text << "'";
+}
+
+void handler2( api::tts::StopSpeakingData data )
+{
+   CLogger::info() << "StopSpeaking event";
+}
+
+void handler3( api::player::StartPlayingData data )
+{
+   CLogger::info() << "StartPlaying event: " << data.status << "; '" << data.file << "'";
+}
+
+void handler4( api::player::StopPlayingData data )
+{
+   CLogger::info() << "StopPlaying event: " << data.file;
+}
+
+/**
+ * Decode the WAV files of the directory or of the manifest offline,
+ * print a tab separated line of the file and its hypothesis for each of them.
+ */
+static int runBatch( const std::string& path, const std::string& language, unsigned int threads )
+{
+   try
+   {
+      CBatchRecognizer recognizer( language, api::asr::RecognizerMode::GRAMMAR_SEARCH, threads );
+      BatchRecognitionResultList results = boost::filesystem::is_directory( path )
+         ? recognizer.decodeDirectory( path ) : recognizer.decodeManifest( path );
+      for ( size_t i = 0; i < results.size(); ++i )
+      {
+         std::cout << results[ i ].file << "\t" << results[ i ].text << std::endl;
+      }
+   }
+   catch ( const std::exception& )
+   {
+      // logged already
+      return 1;
+   }
+   return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+   namespace po = boost::program_options;
+   po::options_description options( "Options" );
+   options.add_options()
+      ( "help", "print this help" )
+      ( "batch", po::value<std::string>(), "decode a directory of 16 kHz WAV files or a manifest listing them and exit" )
+      ( "language", po::value<std::string>()->default_value( "ru-RU" ), "language pack of the batch decoding" )
+      ( "threads", po::value<unsigned int>()->default_value( 0 ), "batch decoders, 0 is one per CPU core" );
+   po::variables_map arguments;
+   try
+   {
+      po::store( po::parse_command_line( argc, argv, options ), arguments );
+      po::notify( arguments );
+   }
+   catch ( const po::error& e )
+   {
+      std::cerr << e.what() << std::endl << options << std::endl;
+      return 1;
+   }
+   if ( arguments.count( "help" ) )
+   {
+      std::cout << options << std::endl;
+      return 0;
+   }
+   if ( arguments.count( "batch" ) )
+   {
+      return runBatch( arguments[ "batch" ].as<std::string>(), arguments[ "language" ].as<std::string>(),
+         arguments[ "threads" ].as<unsigned int>() );
+   }
+
+	gst_init( NULL, NULL );
+
+   GST_DEBUG_CATEGORY_INIT (app_debug, "JENKINS-VR", 0, "JENKINS-VR");
+   FILE* mLogFile = g_fopen( "logfile.txt", "w" );
+
+   if ( mLogFile )
+   {
+      bool result = true;
+      gst_debug_remove_log_function( NULL );
+      gst_debug_add_log_function( gst_debug_log_default, mLogFile, NULL );
+      gst_debug_set_threshold_from_string( "GST_TRACER:7,GST_BUFFER*:7,GST_EVENT:7,GST_MESSAGE:7,JENKINS-VR:7,pocketsphinx:7,CGstPlayerPipeline:7,CGstRecognizerPipeline:7", true );
+   }
+
+   CLogger::setConsoleLogLevel( LogLevel::LEVEL_DEBUG );
+   CLogger::fatal() << "Hello fatal! " << "This is on the same line.";
+   CLogger::error() << "Hello error! " << "This is on the same line.";
+   CLogger::warning() << "Hello warning! " << "This is on the same line.";
+   CLogger::info() << "Hello info! " << "This is on the same line.";
+   CLogger::debug() << "Hello debug! " << "This is on the same line.";
+	return 0;
 }
\ No newline at end of file